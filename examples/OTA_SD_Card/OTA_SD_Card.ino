@@ -0,0 +1,97 @@
+/*
+ * This example demonstrates how to update the firmware from a file stored on an SD card
+ * using Arduino_ESP_OTA library
+ *
+ * Steps:
+ *   1) Create a sketch for your ESP board and verify
+ *      that it both compiles and works.
+ *   2) In the IDE select: Sketch -> Export compiled Binary.
+ *   3) Create an OTA update file utilising the tools 'lzss.py' and 'bin2ota.py' stored in
+ *      https://github.com/arduino-libraries/ArduinoIoTCloud/tree/master/extras/tools .
+ *      A) ./lzss.py --encode SKETCH.bin SKETCH.lzss
+ *      B) ./bin2ota.py ESP SKETCH.lzss SKETCH.ota
+ *   4) Copy the OTA file to the root of a FAT formatted SD card as "update.ota",
+ *      e.g. LOLIN_32_Blink.ino.ota from the examples folder of this library.
+ *   5) Connect the SD card module to the default SPI pins of the board.
+ *   6) Perform an OTA update via steps outlined below.
+ */
+
+/******************************************************************************
+ * INCLUDE
+ ******************************************************************************/
+
+#include <Arduino_ESP32_OTA.h>
+
+#include <SD.h>
+
+/******************************************************************************
+ * CONSTANT
+ ******************************************************************************/
+
+static char const OTA_FILE_PATH[] = "/update.ota";
+
+/******************************************************************************
+ * SETUP/LOOP
+ ******************************************************************************/
+
+void setup()
+{
+  Serial.begin(9600);
+  while (!Serial) {}
+
+  if (!SD.begin())
+  {
+    Serial.println("SD card initialization failed");
+    return;
+  }
+
+  File ota_file = SD.open(OTA_FILE_PATH);
+  if (!ota_file)
+  {
+    Serial.print  ("Unable to open ");
+    Serial.println(OTA_FILE_PATH);
+    return;
+  }
+
+  Arduino_ESP32_OTA ota;
+  Arduino_ESP32_OTA::Error ota_err = Arduino_ESP32_OTA::Error::None;
+
+  Serial.println("Initializing OTA storage");
+  if ((ota_err = ota.begin()) != Arduino_ESP32_OTA::Error::None)
+  {
+    Serial.print  ("Arduino_ESP_OTA::begin() failed with error code ");
+    Serial.println((int)ota_err);
+    return;
+  }
+
+
+  Serial.println("Starting update from SD card to flash ...");
+  int const ota_download = ota.download(ota_file, ota_file.size());
+  ota_file.close();
+  if (ota_download <= 0)
+  {
+    Serial.print  ("Arduino_ESP_OTA::download failed with error code ");
+    Serial.println(ota_download);
+    return;
+  }
+  Serial.print  (ota_download);
+  Serial.println(" bytes stored.");
+
+
+  Serial.println("Verify update integrity and apply ...");
+  if ((ota_err = ota.update()) != Arduino_ESP32_OTA::Error::None)
+  {
+    Serial.print  ("ota.update() failed with error code ");
+    Serial.println((int)ota_err);
+    return;
+  }
+
+  Serial.println("Performing a reset after which the bootloader will start the new firmware.");
+  delay(1000); /* Make sure the serial message gets out before the reset. */
+  ota.reset();
+}
+
+void loop()
+{
+
+}
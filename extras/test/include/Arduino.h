@@ -0,0 +1,82 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <functional>
+
+/**************************************************************************************
+   FUNCTION DECLARATION
+ **************************************************************************************/
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// move the clock returned by millis() and micros() forward, without waiting
+void mock_advance_time(unsigned long ms);
+// stop the clock, until unfrozen millis() and micros() only move with mock_advance_time()
+void mock_freeze_time(bool frozen);
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+class Print {
+public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t * buffer, size_t size);
+};
+
+class Stream : public Print {
+public:
+  Stream() : _timeout(1000) { }
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  // as in the core, it waits up to the timeout for each missing byte
+  virtual size_t readBytes(uint8_t * buffer, size_t length);
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+protected:
+  unsigned long _timeout;
+
+  int timedRead();
+};
+
+class EspClass {
+public:
+  void restart() { }
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 200000; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,43 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Arduino.h>
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+class IPAddress { };
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char * host, uint16_t port) = 0;
+  using Print::write;
+  virtual int read(uint8_t * buf, size_t size) = 0;
+  using Stream::read;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
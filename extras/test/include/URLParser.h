@@ -0,0 +1,48 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// scheme://host[:port][/path][?query], as the parser of ArduinoHttpClient
+class ParsedUrl {
+public:
+  ParsedUrl(const char* url);
+  ~ParsedUrl();
+
+  char* schema() { return _schema; }
+  char* host() { return _host; }
+  uint16_t port() { return _port; }
+  char* path() { return _path; }
+  char* query() { return _query; }
+
+private:
+  char* _schema;
+  char* _host;
+  uint16_t _port;
+  char* _path;
+  char* _query;
+};
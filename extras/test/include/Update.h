@@ -0,0 +1,72 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+/**************************************************************************************
+   DEFINE
+ **************************************************************************************/
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define U_FLASH  0
+#define U_SPIFFS 100
+
+#define UPDATE_ERROR_OK       (0)
+#define UPDATE_ERROR_WRITE    (1)
+#define UPDATE_ERROR_ERASE    (2)
+#define UPDATE_ERROR_SPACE    (4)
+#define UPDATE_ERROR_NO_PARTITION (10)
+#define UPDATE_ERROR_ACTIVATE (11)
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// the Update library of the core, writing to the emulated partitions
+class UpdateClass {
+public:
+  UpdateClass();
+
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = 0, const char *label = NULL);
+  size_t write(uint8_t *data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  void abort();
+
+  bool isRunning() { return _partition != nullptr; }
+  bool hasError() { return _error != UPDATE_ERROR_OK; }
+  uint8_t getError() { return _error; }
+
+private:
+  const esp_partition_t* _partition;
+  int _command;
+  size_t _offset;
+  size_t _buffered;
+  uint8_t _error;
+  uint8_t _buffer[SPI_FLASH_SEC_SIZE];
+
+  bool flush();
+};
+
+extern UpdateClass Update;
@@ -0,0 +1,45 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Client.h>
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// there is no network on the host, tests provide their own Client with setClient()
+class WiFiClient : public Client {
+public:
+  int connect(IPAddress, uint16_t) override { return 0; }
+  int connect(const char *, uint16_t) override { return 0; }
+  size_t write(uint8_t) override { return 0; }
+  size_t write(const uint8_t *, size_t) override { return 0; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t *, size_t) override { return -1; }
+  int peek() override { return -1; }
+  void flush() override { }
+  void stop() override { }
+  uint8_t connected() override { return 0; }
+  operator bool() override { return false; }
+};
@@ -0,0 +1,39 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/**************************************************************************************
+   DEFINE
+ **************************************************************************************/
+
+#define MALLOC_CAP_8BIT (1<<2)
+#define MALLOC_CAP_DMA  (1<<3)
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+inline void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void heap_caps_free(void* ptr) { free(ptr); }
@@ -0,0 +1,93 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**************************************************************************************
+   TYPEDEF
+ **************************************************************************************/
+
+typedef int esp_err_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_SIZE        0x104
+#define ESP_ERR_OTA_VALIDATE_FAILED 0x1503
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP  = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_APP_FACTORY = 0x00,
+  ESP_PARTITION_SUBTYPE_APP_OTA_0   = 0x10,
+  ESP_PARTITION_SUBTYPE_APP_OTA_1   = 0x11,
+  ESP_PARTITION_SUBTYPE_DATA_FAT    = 0x81,
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY         = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  uint32_t erase_size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+/**************************************************************************************
+   FUNCTION DECLARATION
+ **************************************************************************************/
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+/**************************************************************************************
+   EMULATION
+ **************************************************************************************/
+
+/* The flash is emulated with a file, written with the semantics of NOR flash: an
+ * erase sets a whole sector to 0xFF and a write can only clear bits. The running
+ * app is in the first OTA partition of the table.
+ */
+
+// create the flash file at path, erased, with the partitions in table, the default
+// table has ota_0 and ota_1 app partitions and a spiffs data partition
+bool esp_partition_emulation_begin(const char* path, const esp_partition_t* table = nullptr, size_t count = 0);
+void esp_partition_emulation_end();
+
+// partition selected by the last successful esp_ota_set_boot_partition
+const esp_partition_t* esp_partition_emulation_boot();
+
+// number of sectors erased and of write calls since begin
+uint32_t esp_partition_emulation_erases();
+uint32_t esp_partition_emulation_writes();
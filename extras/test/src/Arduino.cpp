@@ -0,0 +1,112 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <thread>
+
+/**************************************************************************************
+   GLOBAL VARIABLES
+ **************************************************************************************/
+
+EspClass ESP;
+
+static unsigned long time_offset_ms = 0;
+static bool time_frozen = false;
+static unsigned long frozen_us = 0;
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+unsigned long micros()
+{
+  static auto const start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  unsigned long const us = time_frozen ? frozen_us : std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  return us + time_offset_ms * 1000;
+}
+
+unsigned long millis()
+{
+  return micros() / 1000;
+}
+
+void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+}
+
+void mock_advance_time(unsigned long ms)
+{
+  time_offset_ms += ms;
+}
+
+void mock_freeze_time(bool frozen)
+{
+  if(frozen && !time_frozen) {
+    frozen_us = micros() - time_offset_ms * 1000;
+  }
+  time_frozen = frozen;
+}
+
+/**************************************************************************************
+   CLASS MEMBER FUNCTION DEFINITION
+ **************************************************************************************/
+
+size_t Print::write(const uint8_t * buffer, size_t size)
+{
+  size_t n = 0;
+  while(size-- > 0 && write(*buffer++) == 1) {
+    n++;
+  }
+  return n;
+}
+
+size_t Stream::readBytes(uint8_t * buffer, size_t length)
+{
+  size_t count = 0;
+  while(count < length) {
+    int c = timedRead();
+    if(c < 0) {
+      break;
+    }
+    buffer[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
+int Stream::timedRead()
+{
+  unsigned long const start = millis();
+  do {
+    int c = read();
+    if(c >= 0) {
+      return c;
+    }
+  } while(millis() - start < _timeout);
+  return -1;
+}
@@ -0,0 +1,69 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <URLParser.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************
+   CTOR/DTOR
+ **************************************************************************************/
+
+static char* copy(const char* begin, const char* end)
+{
+  char* res = (char*)malloc(end - begin + 1);
+  memcpy(res, begin, end - begin);
+  res[end - begin] = '\0';
+  return res;
+}
+
+ParsedUrl::ParsedUrl(const char* url)
+{
+  const char* sep = strstr(url, "://");
+  const char* host = sep != nullptr ? sep + 3 : url;
+
+  _schema = copy(url, sep != nullptr ? sep : url);
+
+  const char* host_end = host + strcspn(host, ":/?");
+  _host = copy(host, host_end);
+
+  const char* cursor = host_end;
+  if(*cursor == ':') {
+    _port = (uint16_t)strtoul(cursor + 1, (char**)&cursor, 10);
+  } else {
+    _port = strcmp(_schema, "https") == 0 ? 443 : 80;
+  }
+
+  const char* query = strchr(cursor, '?');
+  const char* path_end = query != nullptr ? query : cursor + strlen(cursor);
+
+  _path = path_end != cursor ? copy(cursor, path_end) : strdup("/");
+  _query = query != nullptr ? copy(query + 1, query + strlen(query)) : strdup("");
+}
+
+ParsedUrl::~ParsedUrl()
+{
+  free(_schema);
+  free(_host);
+  free(_path);
+  free(_query);
+}
@@ -0,0 +1,133 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Update.h>
+#include <esp_ota_ops.h>
+
+/**************************************************************************************
+   GLOBAL VARIABLES
+ **************************************************************************************/
+
+UpdateClass Update;
+
+/**************************************************************************************
+   CLASS MEMBER FUNCTION DEFINITION
+ **************************************************************************************/
+
+UpdateClass::UpdateClass()
+: _partition(nullptr), _command(U_FLASH), _offset(0), _buffered(0), _error(UPDATE_ERROR_OK)
+{
+}
+
+bool UpdateClass::begin(size_t, int command, int, uint8_t, const char *label)
+{
+  if(_partition != nullptr) {
+    return false;
+  }
+
+  _command = command;
+  _offset = 0;
+  _buffered = 0;
+  _error = UPDATE_ERROR_OK;
+
+  if(command == U_FLASH) {
+    _partition = esp_ota_get_next_update_partition(NULL);
+  } else if(command == U_SPIFFS) {
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, label);
+    if(_partition == nullptr) {
+      // FFat images do not include the first sector of the partition
+      _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+      _offset = 0x1000;
+    }
+  }
+
+  if(_partition == nullptr) {
+    _error = UPDATE_ERROR_NO_PARTITION;
+    return false;
+  }
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len)
+{
+  if(hasError() || !isRunning()) {
+    return 0;
+  }
+
+  if(_offset + _buffered + len > _partition->size) {
+    _partition = nullptr;
+    _error = UPDATE_ERROR_SPACE;
+    return 0;
+  }
+
+  for(size_t i = 0; i < len; i++) {
+    _buffer[_buffered++] = data[i];
+    if(_buffered == sizeof(_buffer) && !flush()) {
+      return 0;
+    }
+  }
+
+  return len;
+}
+
+bool UpdateClass::end(bool)
+{
+  if(hasError() || !isRunning() || !flush()) {
+    return false;
+  }
+
+  if(_command == U_FLASH && esp_ota_set_boot_partition(_partition) != ESP_OK) {
+    _partition = nullptr;
+    _error = UPDATE_ERROR_ACTIVATE;
+    return false;
+  }
+
+  _partition = nullptr;
+  return true;
+}
+
+void UpdateClass::abort()
+{
+  _partition = nullptr;
+}
+
+bool UpdateClass::flush()
+{
+  if(_buffered == 0) {
+    return true;
+  }
+
+  if(esp_partition_erase_range(_partition, _offset, SPI_FLASH_SEC_SIZE) != ESP_OK) {
+    _partition = nullptr;
+    _error = UPDATE_ERROR_ERASE;
+    return false;
+  }
+
+  if(esp_partition_write(_partition, _offset, _buffer, _buffered) != ESP_OK) {
+    _partition = nullptr;
+    _error = UPDATE_ERROR_WRITE;
+    return false;
+  }
+
+  _offset += _buffered;
+  _buffered = 0;
+  return true;
+}
@@ -0,0 +1,203 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/**************************************************************************************
+   GLOBAL VARIABLES
+ **************************************************************************************/
+
+static const esp_partition_t default_table[] = {
+  { ESP_PARTITION_TYPE_APP,  ESP_PARTITION_SUBTYPE_APP_OTA_0,   0x010000, 0x140000, SPI_FLASH_SEC_SIZE, "app0",   false },
+  { ESP_PARTITION_TYPE_APP,  ESP_PARTITION_SUBTYPE_APP_OTA_1,   0x150000, 0x140000, SPI_FLASH_SEC_SIZE, "app1",   false },
+  { ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x290000, 0x160000, SPI_FLASH_SEC_SIZE, "spiffs", false },
+};
+
+static FILE* flash = nullptr;
+static std::vector<esp_partition_t> partitions;
+static const esp_partition_t* boot = nullptr;
+static uint32_t erases = 0;
+static uint32_t writes = 0;
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+static bool valid(const esp_partition_t* partition, size_t offset, size_t size)
+{
+  return flash != nullptr && partition != nullptr &&
+    offset <= partition->size && size <= partition->size - offset;
+}
+
+static bool access(const esp_partition_t* partition, size_t offset, void* data, size_t size, bool write)
+{
+  if(fseek(flash, partition->address + offset, SEEK_SET) != 0) {
+    return false;
+  }
+  return (write ? fwrite(data, 1, size, flash) : fread(data, 1, size, flash)) == size;
+}
+
+bool esp_partition_emulation_begin(const char* path, const esp_partition_t* table, size_t count)
+{
+  esp_partition_emulation_end();
+
+  if(table == nullptr) {
+    table = default_table;
+    count = sizeof(default_table) / sizeof(default_table[0]);
+  }
+
+  partitions.assign(table, table + count);
+
+  size_t size = 0;
+  for(const esp_partition_t& partition : partitions) {
+    if(partition.address + partition.size > size) {
+      size = partition.address + partition.size;
+    }
+  }
+
+  if((flash = fopen(path, "w+b")) == nullptr) {
+    return false;
+  }
+
+  uint8_t erased[SPI_FLASH_SEC_SIZE];
+  memset(erased, 0xFF, sizeof(erased));
+  for(size_t offset = 0; offset < size; offset += sizeof(erased)) {
+    fwrite(erased, 1, sizeof(erased), flash);
+  }
+
+  boot = nullptr;
+  erases = 0;
+  writes = 0;
+
+  return fflush(flash) == 0;
+}
+
+void esp_partition_emulation_end()
+{
+  if(flash != nullptr) {
+    fclose(flash);
+    flash = nullptr;
+  }
+  partitions.clear();
+  boot = nullptr;
+}
+
+const esp_partition_t* esp_partition_emulation_boot()
+{
+  return boot;
+}
+
+uint32_t esp_partition_emulation_erases()
+{
+  return erases;
+}
+
+uint32_t esp_partition_emulation_writes()
+{
+  return writes;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label)
+{
+  for(const esp_partition_t& partition : partitions) {
+    if(partition.type == type &&
+       (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.subtype == subtype) &&
+       (label == nullptr || strcmp(partition.label, label) == 0)) {
+      return &partition;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+  if(!valid(partition, src_offset, size)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  return access(partition, src_offset, dst, size, false) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+  if(!valid(partition, dst_offset, size)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // programming can only clear bits, the sector has to be erased first
+  std::vector<uint8_t> data(size);
+  if(!access(partition, dst_offset, data.data(), size, false)) {
+    return ESP_FAIL;
+  }
+
+  for(size_t i = 0; i < size; i++) {
+    data[i] &= ((const uint8_t*)src)[i];
+  }
+
+  writes++;
+  return access(partition, dst_offset, data.data(), size, true) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+  if(offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if(!valid(partition, offset, size)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  std::vector<uint8_t> erased(size, 0xFF);
+
+  erases += size / SPI_FLASH_SEC_SIZE;
+  return access(partition, offset, erased.data(), size, true) ? ESP_OK : ESP_FAIL;
+}
+
+const esp_partition_t* esp_ota_get_running_partition(void)
+{
+  return esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, nullptr);
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*)
+{
+  return esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, nullptr);
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition)
+{
+  uint8_t magic;
+
+  if(partition == nullptr || partition->type != ESP_PARTITION_TYPE_APP) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // the image has to start with the magic byte of the app images
+  if(esp_partition_read(partition, 0, &magic, 1) != ESP_OK || magic != 0xE9) {
+    return ESP_ERR_OTA_VALIDATE_FAILED;
+  }
+
+  boot = partition;
+  return ESP_OK;
+}
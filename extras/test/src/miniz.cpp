@@ -0,0 +1,78 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <rom/miniz.h>
+
+#include <zlib.h>
+#include <vector>
+
+/**************************************************************************************
+   GLOBAL VARIABLES
+ **************************************************************************************/
+
+// the decoder frees the tinfl state with free(), the zlib streams are released at exit
+struct Streams {
+  std::vector<z_stream*> list;
+  ~Streams() {
+    for(z_stream* z : list) {
+      inflateEnd(z);
+      delete z;
+    }
+  }
+};
+
+static Streams streams;
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+  mz_uint8 *, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags)
+{
+  if(r->m_state == 0) {
+    z_stream* z = new z_stream();
+    inflateInit2(z, (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15);
+    streams.list.push_back(z);
+    r->m_stream = z;
+    r->m_state = 1;
+  }
+
+  z_stream* z = (z_stream*)r->m_stream;
+  z->next_in = (Bytef*)pIn_buf_next;
+  z->avail_in = *pIn_buf_size;
+  z->next_out = pOut_buf_next;
+  z->avail_out = *pOut_buf_size;
+
+  int ret = inflate(z, Z_NO_FLUSH);
+
+  *pIn_buf_size -= z->avail_in;
+  *pOut_buf_size -= z->avail_out;
+
+  if(ret == Z_STREAM_END) {
+    return TINFL_STATUS_DONE;
+  } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+    return TINFL_STATUS_FAILED;
+  } else if(z->avail_out == 0) {
+    return TINFL_STATUS_HAS_MORE_OUTPUT;
+  }
+  return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
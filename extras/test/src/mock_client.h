@@ -0,0 +1,119 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Client.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// an http server behind a Client, the responses are looked up by host, port and request target
+class MockClient : public Client {
+public:
+  // all the requests received, as "host:port" followed by the request
+  std::vector<std::string> requests;
+  // number of connections opened
+  int connections = 0;
+  // at most chunk bytes are available at a time, e.g. to split the status line across reads
+  size_t chunk = SIZE_MAX;
+
+  void serve(const std::string& host, uint16_t port, const std::string& target, const std::string& response) {
+    _responses[key(host, port, target)] = response;
+  }
+
+  static std::string response(int status, const std::string& headers, const std::vector<uint8_t>& body) {
+    return "HTTP/1.1 " + std::to_string(status) + " Mock\r\n" + headers +
+      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + std::string(body.begin(), body.end());
+  }
+
+  static std::string redirect(int status, const std::string& location) {
+    return "HTTP/1.1 " + std::to_string(status) + " Mock\r\nLocation: " + location + "\r\nContent-Length: 0\r\n\r\n";
+  }
+
+  int connect(IPAddress, uint16_t) override { return 0; }
+
+  int connect(const char * host, uint16_t port) override {
+    _host = host;
+    _port = port;
+    _connected = true;
+    _response.clear();
+    _position = 0;
+    connections++;
+    return 1;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t * buf, size_t size) override {
+    _request.append((const char*)buf, size);
+
+    size_t end = _request.find("\r\n\r\n");
+    if(end != std::string::npos) {
+      std::string target = _request.substr(4, _request.find(' ', 4) - 4);
+      auto it = _responses.find(key(_host, _port, target));
+
+      // the bytes of the previous response that have not been read come first, as on a socket
+      requests.push_back(_host + ":" + std::to_string(_port) + " " + _request.substr(0, end));
+      _response = _response.substr(_position) + (it != _responses.end() ? it->second : response(404, "", {}));
+      _position = 0;
+      _request.clear();
+    }
+    return size;
+  }
+
+  int available() override {
+    size_t left = _response.size() - _position;
+    return left < chunk ? left : chunk;
+  }
+  int read() override { return _position < _response.size() ? (uint8_t)_response[_position++] : -1; }
+  int peek() override { return _position < _response.size() ? (uint8_t)_response[_position] : -1; }
+
+  int read(uint8_t * buf, size_t size) override {
+    size_t len = (size_t)available() < size ? available() : size;
+    memcpy(buf, _response.data() + _position, len);
+    _position += len;
+    return len;
+  }
+
+  void flush() override { }
+  void stop() override { _connected = false; _response.clear(); _position = 0; }
+  uint8_t connected() override { return _connected; }
+  operator bool() override { return _connected; }
+
+private:
+  std::map<std::string, std::string> _responses;
+  std::string _host;
+  uint16_t _port = 0;
+  bool _connected = false;
+  std::string _request;
+  std::string _response;
+  size_t _position = 0;
+
+  static std::string key(const std::string& host, uint16_t port, const std::string& target) {
+    return host + ":" + std::to_string(port) + target;
+  }
+};
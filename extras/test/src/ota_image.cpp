@@ -0,0 +1,218 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "ota_image.h"
+
+#include <fstream>
+#include <iterator>
+#include <string.h>
+#include <zlib.h>
+
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+std::vector<uint8_t> ota_compress(const std::vector<uint8_t>& data)
+{
+#if defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  return data;
+#else
+  // every byte is a literal: a 1 bit followed by its 8 bits, msb first
+  std::vector<uint8_t> out;
+  uint32_t bits = 0;
+  uint8_t count = 0;
+
+  for(uint8_t c : data) {
+    bits = (bits << 9) | 0x100 | c;
+    count += 9;
+    while(count >= 8) {
+      out.push_back((uint8_t)(bits >> (count - 8)));
+      count -= 8;
+    }
+  }
+
+  if(count > 0) {
+    out.push_back((uint8_t)(bits << (8 - count)));
+  }
+
+  return out;
+#endif
+}
+
+std::vector<uint8_t> zlib_compress(const std::vector<uint8_t>& data)
+{
+  uLongf len = compressBound(data.size());
+  std::vector<uint8_t> out(len);
+  compress2(out.data(), &len, data.data(), data.size(), 9);
+  out.resize(len);
+  return out;
+}
+
+void put_le32(std::vector<uint8_t>& out, uint32_t value)
+{
+  for(int i = 0; i < 4; i++) {
+    out.push_back((uint8_t)(value >> (8 * i)));
+  }
+}
+
+std::vector<uint8_t> block_container(const std::vector<std::vector<uint8_t>>& blocks)
+{
+  std::vector<uint8_t> out;
+
+  put_le32(out, blocks.size());
+  for(const std::vector<uint8_t>& block : blocks) {
+    put_le32(out, block.size());
+    put_le32(out, crc32(0, block.data(), block.size()));
+  }
+  for(const std::vector<uint8_t>& block : blocks) {
+    out.insert(out.end(), block.begin(), block.end());
+  }
+
+  return out;
+}
+
+std::vector<uint8_t> erased_runs(const std::vector<uint8_t>& data, size_t min_run)
+{
+  std::vector<uint8_t> out;
+  size_t literal = 0;
+
+  for(size_t i = 0; i <= data.size(); ) {
+    size_t run = 0;
+
+    while(i + run < data.size() && data[i + run] == 0xFF) {
+      run++;
+    }
+
+    if(run < min_run && i + run < data.size()) {
+      i += run + 1;
+      continue;
+    }
+
+    // a record: the literal bytes before the run, then the run length
+    put_le32(out, i - literal);
+    out.insert(out.end(), data.begin() + literal, data.begin() + i);
+    put_le32(out, run);
+
+    i += run;
+    literal = i;
+
+    if(i == data.size()) {
+      break;
+    }
+  }
+
+  return out;
+}
+
+std::vector<uint8_t> ota_image(const std::vector<uint8_t>& payload, uint8_t flags, uint8_t version, uint32_t magic)
+{
+  std::vector<uint8_t> image(20, 0);
+
+  for(int i = 0; i < 4; i++) {
+    image[8 + i] = (uint8_t)(magic >> (8 * i));
+  }
+  image[12] = version;
+  image[13] = flags;
+  image.insert(image.end(), payload.begin(), payload.end());
+
+  uint32_t len = image.size() - 8;
+  uint32_t crc = crc32(0, image.data() + 8, image.size() - 8);
+
+  for(int i = 0; i < 4; i++) {
+    image[i] = (uint8_t)(len >> (8 * i));
+    image[4 + i] = (uint8_t)(crc >> (8 * i));
+  }
+
+  return image;
+}
+
+std::vector<uint8_t> ota_encrypt(const std::vector<uint8_t>& payload, const std::vector<uint8_t>& key, uint8_t flags, uint8_t version, uint32_t magic)
+{
+  const mbedtls_md_info_t* sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  std::vector<uint8_t> header = ota_image({}, flags, version, magic);
+  std::vector<uint8_t> out(16);
+  uint8_t nonce_counter[16];
+  uint8_t stream_block[16];
+  uint8_t mac_key[32];
+  uint8_t tag[32];
+  size_t nc_off = 0;
+
+  for(size_t i = 0; i < out.size(); i++) {
+    out[i] = (uint8_t)(0xA0 + 7 * i);
+    nonce_counter[i] = out[i];
+  }
+  out.resize(out.size() + payload.size());
+
+  mbedtls_aes_context aes;
+  mbedtls_aes_init(&aes);
+  mbedtls_aes_setkey_enc(&aes, key.data(), key.size() * 8);
+  mbedtls_aes_crypt_ctr(&aes, payload.size(), &nc_off, nonce_counter, stream_block, payload.data(), out.data() + 16);
+  mbedtls_aes_free(&aes);
+
+  // the 12 header bytes following the crc, the counter block and the ciphertext
+  const char* label = "Arduino_ESP32_OTA MAC";
+  mbedtls_md_hmac(sha256, key.data(), key.size(), (const uint8_t*)label, strlen(label), mac_key);
+
+  mbedtls_md_context_t mac;
+  mbedtls_md_init(&mac);
+  mbedtls_md_setup(&mac, sha256, 1);
+  mbedtls_md_hmac_starts(&mac, mac_key, sizeof(mac_key));
+  mbedtls_md_hmac_update(&mac, header.data() + 8, 12);
+  mbedtls_md_hmac_update(&mac, out.data(), out.size());
+  mbedtls_md_hmac_finish(&mac, tag);
+  mbedtls_md_free(&mac);
+
+  out.insert(out.end(), tag, tag + sizeof(tag));
+  return out;
+}
+
+std::vector<uint8_t> app_image(size_t size)
+{
+  std::vector<uint8_t> image(size);
+  uint32_t state = 0x12345678;
+
+  // pseudo random bytes, with runs of erased flash every few sectors
+  for(size_t i = 0; i < size; i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    image[i] = (i / 1024) % 5 == 4 ? 0xFF : (uint8_t)state;
+  }
+  image[0] = 0xE9;
+
+  return image;
+}
+
+std::vector<uint8_t> read_file(const std::string& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::vector<uint8_t> read_partition(const esp_partition_t* partition, size_t offset, size_t size)
+{
+  std::vector<uint8_t> data(size);
+  esp_partition_read(partition, offset, data.data(), size);
+  return data;
+}
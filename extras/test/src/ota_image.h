@@ -0,0 +1,111 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Arduino.h>
+#include <Arduino_ESP32_OTA.h>
+#include <esp_partition.h>
+
+#include <string>
+#include <vector>
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static uint32_t const TEST_MAGIC = 0x45535033;
+
+/**************************************************************************************
+   FUNCTION DECLARATION
+ **************************************************************************************/
+
+// the payload as the default decoder of the build expects it: LZSS made only of
+// literals, or the data itself when ARDUINO_ESP32_OTA_NO_LZSS is defined
+std::vector<uint8_t> ota_compress(const std::vector<uint8_t>& data);
+
+// a zlib stream of data, as payloads flagged PayloadFlagDeflate carry it
+std::vector<uint8_t> zlib_compress(const std::vector<uint8_t>& data);
+
+// appends value little endian, the byte order of the container indexes
+void put_le32(std::vector<uint8_t>& out, uint32_t value);
+
+// a block container payload: the block count, the length and crc32 of each block,
+// then the blocks
+std::vector<uint8_t> block_container(const std::vector<std::vector<uint8_t>>& blocks);
+
+// the records of a payload flagged PayloadFlagErasedRuns: the runs of at least
+// min_run erased bytes are replaced by their length
+std::vector<uint8_t> erased_runs(const std::vector<uint8_t>& data, size_t min_run = 16);
+
+// an .ota file: the header followed by the payload
+// version: byte 12 of the header, the header_version field
+// flags: byte 13 of the header, payload_target in the high nibble and spare in the low one
+std::vector<uint8_t> ota_image(const std::vector<uint8_t>& payload, uint8_t flags = 0, uint8_t version = 0, uint32_t magic = TEST_MAGIC);
+
+// the payload of an encrypted .ota file: a fixed initial counter block, the AES-CTR
+// ciphertext and the HMAC-SHA256 tag, for the header ota_image() builds with the same
+// flags, version and magic. flags must include PayloadFlagEncrypted
+std::vector<uint8_t> ota_encrypt(const std::vector<uint8_t>& payload, const std::vector<uint8_t>& key,
+  uint8_t flags, uint8_t version = 0, uint32_t magic = TEST_MAGIC);
+
+// an app image of size bytes, it starts with the magic byte checked when it is booted
+std::vector<uint8_t> app_image(size_t size);
+
+std::vector<uint8_t> read_file(const std::string& path);
+std::vector<uint8_t> read_partition(const esp_partition_t* partition, size_t offset, size_t size);
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// counts the bytes written to flash
+class CountingOta : public Arduino_ESP32_OTA {
+public:
+  size_t written = 0;
+
+  void write_byte_to_flash(uint8_t data) override {
+    written++;
+    Arduino_ESP32_OTA::write_byte_to_flash(data);
+  }
+};
+
+// a Stream over a buffer, available() reports at most chunk bytes at a time
+class MemoryStream : public Stream {
+public:
+  MemoryStream(const std::vector<uint8_t>& data, size_t chunk = SIZE_MAX)
+  : _data(data), _position(0), _chunk(chunk) { }
+
+  int available() override {
+    size_t left = _data.size() - _position;
+    return left < _chunk ? left : _chunk;
+  }
+  int read() override { return _position < _data.size() ? _data[_position++] : -1; }
+  int peek() override { return _position < _data.size() ? _data[_position] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+  size_t position() const { return _position; }
+
+private:
+  std::vector<uint8_t> _data;
+  size_t _position;
+  size_t _chunk;
+};
@@ -0,0 +1,91 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static size_t const BLOCK_SIZE = 2 * SPI_FLASH_SEC_SIZE;
+static size_t const BLOCK_COUNT = 4;
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A corrupted block aborts the download before the next blocks are written", "[BlockContainer]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA::FlashWriter writer = GENERATE(Arduino_ESP32_OTA::FlashWriterUpdate, Arduino_ESP32_OTA::FlashWriterPartition);
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> app = app_image(BLOCK_COUNT * BLOCK_SIZE);
+  std::vector<std::vector<uint8_t>> blocks;
+  Arduino_ESP32_OTA ota;
+
+  for(size_t i = 0; i < BLOCK_COUNT; i++) {
+    blocks.push_back(ota_compress(std::vector<uint8_t>(app.begin() + i * BLOCK_SIZE, app.begin() + (i + 1) * BLOCK_SIZE)));
+  }
+
+  ota.setFlashWriter(writer);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  SECTION("all the blocks are valid")
+  {
+    std::vector<uint8_t> image = ota_image(block_container(blocks), 0, Arduino_ESP32_OTA::PayloadContainerBlocks);
+    MemoryStream stream(image);
+    uint32_t const writes = esp_partition_emulation_writes();
+
+    REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+    REQUIRE(esp_partition_emulation_writes() - writes >= BLOCK_COUNT * BLOCK_SIZE / SPI_FLASH_SEC_SIZE - 1);
+    REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(read_partition(partition, 0, app.size()) == app);
+  }
+
+  SECTION("the second block is corrupted")
+  {
+    // a byte in the middle of the second block is changed after its crc has been computed
+    std::vector<uint8_t> payload = block_container(blocks);
+    payload[4 + 8 * BLOCK_COUNT + blocks[0].size() + blocks[1].size() / 2] ^= 0x01;
+
+    std::vector<uint8_t> image = ota_image(payload, 0, Arduino_ESP32_OTA::PayloadContainerBlocks);
+    MemoryStream stream(image);
+    uint32_t const writes = esp_partition_emulation_writes();
+
+    REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaBlockCrc));
+
+    // at most the sectors of the first two blocks have been programmed, the remaining
+    // blocks are neither downloaded nor written
+    REQUIRE(esp_partition_emulation_writes() - writes <= 2 * BLOCK_SIZE / SPI_FLASH_SEC_SIZE);
+    REQUIRE(stream.position() < image.size() - blocks[2].size() - blocks[3].size() + ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE);
+    REQUIRE(read_partition(partition, 2 * BLOCK_SIZE, 2 * BLOCK_SIZE) == std::vector<uint8_t>(2 * BLOCK_SIZE, 0xFF));
+    REQUIRE(esp_partition_emulation_boot() == nullptr);
+  }
+
+  esp_partition_emulation_end();
+}
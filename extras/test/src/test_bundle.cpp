@@ -0,0 +1,249 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+#include <zlib.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   TYPEDEF
+ **************************************************************************************/
+
+struct Section {
+  uint8_t target;
+  uint8_t flags;
+  std::vector<uint8_t> data;
+};
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+static std::vector<uint8_t> bundle_payload(const std::vector<Section>& sections)
+{
+  std::vector<uint8_t> out;
+
+  put_le32(out, sections.size());
+  for(const Section& section : sections) {
+    put_le32(out, section.target | (section.flags << 8));
+    put_le32(out, section.data.size());
+    put_le32(out, crc32(0, section.data.data(), section.data.size()));
+  }
+  for(const Section& section : sections) {
+    out.insert(out.end(), section.data.begin(), section.data.end());
+  }
+
+  return out;
+}
+
+static std::vector<uint8_t> bundle(const std::vector<Section>& sections)
+{
+  return ota_image(bundle_payload(sections), 0, Arduino_ESP32_OTA::PayloadContainerBundle);
+}
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A bundle writes the data partition and then the app", "[Bundle]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(50000);
+  std::vector<uint8_t> fs(40000, 0x5A);
+  const esp_partition_t* app_partition = esp_ota_get_next_update_partition(NULL);
+  const esp_partition_t* fs_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+  std::vector<uint8_t> image = bundle({
+    { Arduino_ESP32_OTA::PayloadTargetFilesystem, Arduino_ESP32_OTA::PayloadFlagDeflate, zlib_compress(fs) },
+    { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+  });
+
+  bool deferred = false;
+
+  SECTION("with the Update library")
+  {
+    // the data partition is finalized when its section is complete
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterUpdate);
+  }
+
+  SECTION("with the partition writer")
+  {
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterPartition);
+    deferred = true;
+  }
+
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)(fs.size() + app.size()));
+
+  // the app is not activated before update(), the partition writer programs the
+  // first bytes of the data partition then
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+  REQUIRE(read_partition(fs_partition, 16, fs.size() - 16) == std::vector<uint8_t>(fs.begin() + 16, fs.end()));
+  REQUIRE((read_partition(fs_partition, 0, 16) == std::vector<uint8_t>(16, 0xFF)) == deferred);
+
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(esp_partition_emulation_boot() == app_partition);
+  REQUIRE(read_partition(app_partition, 0, app.size()) == app);
+  REQUIRE(read_partition(fs_partition, 0, fs.size()) == fs);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A bundle without an app section leaves the boot partition", "[Bundle]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> fs = app_image(30000);
+  const esp_partition_t* fs_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+  std::vector<uint8_t> image = bundle({
+    { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+  });
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)fs.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+  REQUIRE(read_partition(fs_partition, 0, fs.size()) == fs);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("An invalid bundle does not activate the app", "[Bundle]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(50000);
+  std::vector<uint8_t> fs(40000, 0x5A);
+  std::vector<uint8_t> image;
+  Arduino_ESP32_OTA::Error error;
+
+  SECTION("the app section is not the last one")
+  {
+    image = bundle({
+      { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+      { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+    });
+    error = Arduino_ESP32_OTA::Error::OtaBundle;
+  }
+
+  SECTION("a target is repeated")
+  {
+    image = bundle({
+      { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+      { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+    });
+    error = Arduino_ESP32_OTA::Error::OtaBundle;
+  }
+
+  SECTION("the flags are set in the ota header")
+  {
+    image = bundle({
+      { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+    });
+    image[13] |= Arduino_ESP32_OTA::PayloadFlagDeflate;
+    error = Arduino_ESP32_OTA::Error::OtaBundle;
+  }
+
+  SECTION("an encrypted bundle has a data section")
+  {
+    static const std::vector<uint8_t> key(16, 0x2B);
+    uint8_t flags = Arduino_ESP32_OTA::PayloadFlagEncrypted;
+    std::vector<uint8_t> payload = bundle_payload({
+      { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+      { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+    });
+    image = ota_image(ota_encrypt(payload, key, flags, Arduino_ESP32_OTA::PayloadContainerBundle),
+      flags, Arduino_ESP32_OTA::PayloadContainerBundle);
+    ota.setDecryptionKey(key.data(), key.size());
+    error = Arduino_ESP32_OTA::Error::OtaBundle;
+  }
+
+  SECTION("the app section is corrupted before a data section")
+  {
+    image = bundle({
+      { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+    });
+    image[image.size() - 100] ^= 0x01;
+    error = Arduino_ESP32_OTA::Error::OtaBlockCrc;
+  }
+
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(error));
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A bundle failing once its data section has started is a partial update", "[Bundle]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(50000);
+  std::vector<uint8_t> fs(40000, 0x5A);
+  const esp_partition_t* fs_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+  std::vector<uint8_t> image = bundle({
+    { Arduino_ESP32_OTA::PayloadTargetFilesystem, 0, ota_compress(fs) },
+    { Arduino_ESP32_OTA::PayloadTargetApp, 0, ota_compress(app) },
+  });
+  Arduino_ESP32_OTA::FlashWriter writer = GENERATE(Arduino_ESP32_OTA::FlashWriterUpdate, Arduino_ESP32_OTA::FlashWriterPartition);
+
+  ota.setFlashWriter(writer);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  SECTION("the app section is corrupted")
+  {
+    image[image.size() - 100] ^= 0x01;
+    MemoryStream stream(image);
+
+    REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaPartialUpdate));
+  }
+
+  SECTION("the image crc does not match")
+  {
+    image[4] ^= 0x01;
+    MemoryStream stream(image);
+
+    REQUIRE(ota.download(stream, image.size()) == (int)(fs.size() + app.size()));
+    REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::OtaPartialUpdate);
+  }
+
+  // the partition writer never programs the first bytes of the data partition
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+  if(writer == Arduino_ESP32_OTA::FlashWriterPartition) {
+    REQUIRE(read_partition(fs_partition, 0, 16) == std::vector<uint8_t>(16, 0xFF));
+  }
+
+  esp_partition_emulation_end();
+}
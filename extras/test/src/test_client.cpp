@@ -0,0 +1,119 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include <memory>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// records its destruction, the library must never delete a client it does not own
+class TrackedClient : public MockClient {
+public:
+  TrackedClient(bool& destroyed) : _destroyed(destroyed) { _destroyed = false; }
+  ~TrackedClient() override { _destroyed = true; }
+
+private:
+  bool& _destroyed;
+};
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A client set by the application is stopped, not deleted", "[Client]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  bool destroyed;
+  TrackedClient* client = new TrackedClient(destroyed);
+  std::unique_ptr<Arduino_ESP32_OTA> ota(new Arduino_ESP32_OTA());
+  std::vector<uint8_t> app = app_image(20000);
+  std::string image = MockClient::response(200, "", ota_image(ota_compress(app)));
+
+  ota->setClient(client);
+  REQUIRE(ota->begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  SECTION("when the download is completed")
+  {
+    client->serve("ota.test", 80, "/app.ota", image);
+
+    REQUIRE(ota->download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(ota->update() == Arduino_ESP32_OTA::Error::None);
+  }
+
+  SECTION("when the download fails")
+  {
+    REQUIRE(ota->download("http://ota.test/missing.ota") == static_cast<int>(Arduino_ESP32_OTA::Error::HttpResponse));
+  }
+
+  SECTION("when a redirect leaves the origin")
+  {
+    client->serve("ota.test", 80, "/app.ota", MockClient::redirect(302, "http://cdn.test/app.ota"));
+    client->serve("cdn.test", 80, "/app.ota", image);
+
+    REQUIRE(ota->download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(client->connections == 2);
+  }
+
+  SECTION("when the library is destroyed during a download")
+  {
+    client->serve("ota.test", 80, "/app.ota", image);
+
+    REQUIRE(ota->startDownload("http://ota.test/app.ota") > 0);
+    REQUIRE(client->connected());
+    ota.reset();
+  }
+
+  SECTION("when another client replaces it after a download")
+  {
+    MockClient other;
+
+    client->serve("ota.test", 80, "/app.ota", image);
+    other.serve("ota.test", 80, "/app.ota", image);
+
+    REQUIRE(ota->download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(ota->update() == Arduino_ESP32_OTA::Error::None);
+    ota->setClient(&other);
+    REQUIRE(ota->begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(ota->download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(other.connections == 1);
+    REQUIRE_FALSE(other.connected());
+    ota.reset();
+  }
+
+  REQUIRE_FALSE(destroyed);
+  REQUIRE_FALSE(client->connected());
+
+  delete client;
+  REQUIRE(destroyed);
+
+  esp_partition_emulation_end();
+}
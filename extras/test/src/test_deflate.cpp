@@ -0,0 +1,215 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+#include <zlib.h>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+static std::vector<uint8_t> gzip_compress(const std::vector<uint8_t>& data)
+{
+  z_stream z = {};
+  std::vector<uint8_t> out(compressBound(data.size()) + 32);
+
+  deflateInit2(&z, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  z.next_in = (Bytef*)data.data();
+  z.avail_in = data.size();
+  z.next_out = out.data();
+  z.avail_out = out.size();
+  deflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+
+  return out;
+}
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A deflate payload is inflated to flash", "[Deflate]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(100000);
+  std::vector<uint8_t> image = ota_image(zlib_compress(app), Arduino_ESP32_OTA::PayloadFlagDeflate);
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("Invalid deflate data stops the download", "[Deflate]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(100000);
+  std::vector<uint8_t> payload = zlib_compress(app);
+  std::vector<uint8_t> image;
+
+  // the image crc is computed on the corrupted data, only the decoder can detect it:
+  // the first deflate block following the zlib header gets the reserved type
+  std::fill(payload.begin() + 2, payload.begin() + 66, 0xFF);
+
+  SECTION("in a stream payload")
+  {
+    image = ota_image(payload, Arduino_ESP32_OTA::PayloadFlagDeflate);
+  }
+
+  SECTION("in a block of a block container")
+  {
+    std::vector<uint8_t> first = zlib_compress(std::vector<uint8_t>(app.begin(), app.begin() + 4096));
+    image = ota_image(block_container({first, payload}), Arduino_ESP32_OTA::PayloadFlagDeflate,
+      Arduino_ESP32_OTA::PayloadContainerBlocks);
+  }
+
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaCompression));
+  REQUIRE(stream.position() < image.size());
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("gzip responses are only requested when enabled", "[Deflate]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  MockClient client;
+  std::vector<uint8_t> app = app_image(50000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+
+  client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "", image));
+  ota.setClient(&client);
+
+  SECTION("by default")
+  {
+    REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(ota.download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(client.requests.size() == 1);
+    REQUIRE(client.requests[0].find("Accept-Encoding: identity") != std::string::npos);
+  }
+
+  SECTION("with setAcceptGzip()")
+  {
+    ota.setAcceptGzip(true);
+    REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(ota.download("http://ota.test/app.ota") == (int)app.size());
+    REQUIRE(client.requests.size() == 1);
+    REQUIRE(client.requests[0].find("Accept-Encoding: gzip, identity") != std::string::npos);
+  }
+
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A response with Content-Encoding: gzip is decompressed", "[Deflate]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  MockClient client;
+  std::vector<uint8_t> app = app_image(50000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+
+  client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "Content-Encoding: gzip\r\n", gzip_compress(image)));
+  ota.setClient(&client);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download("http://ota.test/app.ota") == (int)app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("The inflated bytes written by a poll are limited by the time budget", "[Deflate]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  CountingOta ota;
+  std::vector<uint8_t> app(200000, 0x55);
+  std::vector<uint8_t> image;
+  int res;
+
+  // a few bytes of a highly compressed payload inflate to kilobytes
+  app[0] = 0xE9;
+  ota.setPollBudget(0, 1);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  SECTION("in a deflate payload")
+  {
+    image = ota_image(zlib_compress(app), Arduino_ESP32_OTA::PayloadFlagDeflate);
+    client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "", image));
+  }
+
+  SECTION("in the blocks of a block container")
+  {
+    std::vector<uint8_t> first(app.begin(), app.begin() + app.size() / 2);
+    std::vector<uint8_t> second(app.begin() + app.size() / 2, app.end());
+
+    image = ota_image(block_container({zlib_compress(first), zlib_compress(second)}),
+      Arduino_ESP32_OTA::PayloadFlagDeflate, Arduino_ESP32_OTA::PayloadContainerBlocks);
+    client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "", image));
+  }
+
+  SECTION("in a gzip response")
+  {
+    image = ota_image(ota_compress(app));
+    client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "Content-Encoding: gzip\r\n", gzip_compress(image)));
+  }
+
+  ota.setClient(&client);
+  REQUIRE(ota.startDownload("http://ota.test/app.ota") > 0);
+
+  do {
+    size_t written = ota.written;
+    res = ota.downloadPoll();
+    REQUIRE(ota.written - written <= ARDUINO_ESP32_OTA_POLL_INFLATE_SLICE);
+  } while(res == 0);
+
+  REQUIRE(res == 1);
+  REQUIRE(ota.written == app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
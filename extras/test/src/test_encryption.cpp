@@ -0,0 +1,136 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static const std::vector<uint8_t> KEY = {
+  0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static uint8_t const ENCRYPTED = Arduino_ESP32_OTA::PayloadFlagEncrypted;
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("An encrypted image is decrypted whatever the size of the reads", "[Encryption]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image = ota_image(ota_encrypt(ota_compress(app), KEY, ENCRYPTED), ENCRYPTED);
+
+  // the counter block and the tag are split across reads
+  size_t chunk = GENERATE(1, 7, 13, 1000);
+  MemoryStream stream(image, chunk);
+
+  ota.setDecryptionKey(KEY.data(), KEY.size());
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  REQUIRE(esp_partition_emulation_boot() == partition);
+  REQUIRE(read_partition(partition, 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A tampered encrypted image is not activated", "[Encryption]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> payload = ota_encrypt(ota_compress(app), KEY, ENCRYPTED);
+
+  // the crc of the image is computed after the change, only the tag detects it
+  SECTION("in the ciphertext")
+  {
+    // a data bit of an LZSS literal, the decoder does not fail on it
+    payload[16 + 10] ^= 0x01;
+  }
+
+  SECTION("in the tag")
+  {
+    payload[payload.size() - 1] ^= 0x80;
+  }
+
+  std::vector<uint8_t> image = ota_image(payload, ENCRYPTED);
+  MemoryStream stream(image);
+
+  ota.setDecryptionKey(KEY.data(), KEY.size());
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::OtaAuthentication);
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("An encrypted image that cannot be decrypted is rejected before it is written", "[Encryption]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> image;
+  Arduino_ESP32_OTA::Error error;
+
+  SECTION("no key has been set")
+  {
+    image = ota_image(ota_encrypt(ota_compress(app_image(1000)), KEY, ENCRYPTED), ENCRYPTED);
+    error = Arduino_ESP32_OTA::Error::OtaDecryptionKey;
+  }
+
+  SECTION("the payload is shorter than the counter block and the tag")
+  {
+    image = ota_image(std::vector<uint8_t>(40, 0x55), ENCRYPTED);
+    ota.setDecryptionKey(KEY.data(), KEY.size());
+    error = Arduino_ESP32_OTA::Error::OtaDecryptionKey;
+  }
+
+  SECTION("it targets the filesystem")
+  {
+    uint8_t flags = ENCRYPTED | (Arduino_ESP32_OTA::PayloadTargetFilesystem << 4);
+    image = ota_image(ota_encrypt(ota_compress(app_image(1000)), KEY, flags), flags);
+    ota.setDecryptionKey(KEY.data(), KEY.size());
+    error = Arduino_ESP32_OTA::Error::OtaPayloadTarget;
+  }
+
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(error));
+  REQUIRE(esp_partition_emulation_writes() == 0);
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
@@ -0,0 +1,183 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+#include <decompress/erased_runs.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+// an app image with erased runs: in a sector, across sectors and at its end
+static std::vector<uint8_t> sparse_app()
+{
+  std::vector<uint8_t> app = app_image(40000);
+
+  std::fill(app.begin() + 1000, app.begin() + 1100, 0xFF);
+  std::fill(app.begin() + 5000, app.begin() + 5000 + 3 * SPI_FLASH_SEC_SIZE + 100, 0xFF);
+  std::fill(app.end() - 6000, app.end(), 0xFF);
+
+  return app;
+}
+
+// the image is written over a partition that is not erased, the number of
+// flash writes is returned
+static uint32_t update(Arduino_ESP32_OTA::FlashWriter writer, const std::vector<uint8_t>& app, uint8_t flags)
+{
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> const payload = flags & Arduino_ESP32_OTA::PayloadFlagErasedRuns ? erased_runs(app) : app;
+  std::vector<uint8_t> const image = ota_image(ota_compress(payload), flags);
+  std::vector<uint8_t> const dirty(app.size(), 0x5A);
+  Arduino_ESP32_OTA ota;
+  MemoryStream stream(image);
+
+  REQUIRE(esp_partition_write(partition, 0, dirty.data(), dirty.size()) == ESP_OK);
+  uint32_t const writes = esp_partition_emulation_writes();
+
+  ota.setFlashWriter(writer);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(partition, 0, app.size()) == app);
+
+  return esp_partition_emulation_writes() - writes;
+}
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("Erased runs are decoded", "[ErasedRunDecoder]")
+{
+  std::vector<uint8_t> data = sparse_app();
+  std::vector<uint8_t> out;
+  ErasedRunDecoder decoder(
+    [&out](uint8_t c){ out.push_back(c); },
+    [&out](uint32_t len){ out.insert(out.end(), len, 0xFF); });
+
+  SECTION("runs of any length")
+  {
+    data.resize(GENERATE(0, 1, 16, 200));
+    std::fill(data.begin(), data.end(), 0xFF);
+  }
+
+  SECTION("runs in an app image")
+  {
+  }
+
+  std::vector<uint8_t> const records = erased_runs(data);
+
+  REQUIRE(decoder.done());
+  for(uint8_t c : records) {
+    decoder.decode(c);
+  }
+
+  REQUIRE(decoder.done());
+  REQUIRE(out == data);
+}
+
+TEST_CASE("A truncated erased run record is not done", "[ErasedRunDecoder]")
+{
+  std::vector<uint8_t> const records = erased_runs(sparse_app());
+  ErasedRunDecoder decoder([](uint8_t){ }, [](uint32_t){ });
+
+  // the last record is | 4 | literal | 4 |, it is cut in each of its parts
+  size_t const cut = GENERATE(1, 4, 5, 8);
+
+  for(size_t i = 0; i < records.size() - cut; i++) {
+    decoder.decode(records[i]);
+  }
+
+  REQUIRE_FALSE(decoder.done());
+
+  decoder.reset();
+  REQUIRE(decoder.done());
+}
+
+TEST_CASE("Both flash writers write the same image with erased runs", "[ErasedRunDecoder]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  std::vector<uint8_t> const app = sparse_app();
+  uint8_t const flags = Arduino_ESP32_OTA::PayloadFlagErasedRuns;
+
+  uint32_t const update_writes = update(Arduino_ESP32_OTA::FlashWriterUpdate, app, flags);
+  uint32_t const partition_writes = update(Arduino_ESP32_OTA::FlashWriterPartition, app, flags);
+  uint32_t const plain_writes = update(Arduino_ESP32_OTA::FlashWriterPartition, app, 0);
+
+  // the erased sectors are only erased by the partition writer, not programmed
+  REQUIRE(partition_writes < update_writes);
+  REQUIRE(partition_writes < plain_writes);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A payload ending inside an erased run record is rejected", "[ErasedRunDecoder]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA::FlashWriter writer = GENERATE(Arduino_ESP32_OTA::FlashWriterUpdate, Arduino_ESP32_OTA::FlashWriterPartition);
+  std::vector<uint8_t> records = erased_runs(sparse_app());
+  std::vector<uint8_t> payload;
+  uint8_t flags = Arduino_ESP32_OTA::PayloadFlagErasedRuns;
+  uint8_t version = Arduino_ESP32_OTA::PayloadContainerStream;
+  Arduino_ESP32_OTA ota;
+
+  // the erased length of the last record is cut
+  records.resize(records.size() - 2);
+
+  SECTION("in a stream")
+  {
+    payload = ota_compress(records);
+  }
+
+  SECTION("at the end of a block")
+  {
+    size_t const half = records.size() / 2;
+    std::vector<uint8_t> const first(records.begin(), records.begin() + half);
+    std::vector<uint8_t> const second(records.begin() + half, records.end());
+
+    payload = block_container({ ota_compress(first), ota_compress(second) });
+    version = Arduino_ESP32_OTA::PayloadContainerBlocks;
+  }
+
+  SECTION("at the end of the last block")
+  {
+    payload = block_container({ ota_compress(records) });
+    version = Arduino_ESP32_OTA::PayloadContainerBlocks;
+  }
+
+  std::vector<uint8_t> const image = ota_image(payload, flags, version);
+  MemoryStream stream(image);
+
+  ota.setFlashWriter(writer);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaCompression));
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
@@ -0,0 +1,299 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+#include <http/http_client.h>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static uint32_t const TIMEOUT_ms = 1000;
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+// the body of the response: the bytes received with the headers, then the rest
+static std::string body(OtaHttpClient& http, const uint8_t* buffer, MockClient& client)
+{
+  std::string out((const char*)buffer, http.bodyAvailable());
+
+  for(int c; (c = client.read()) >= 0; ) {
+    out.push_back((char)c);
+  }
+
+  return out;
+}
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A response split across reads is parsed", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  OtaHttpClient http(buffer, sizeof(buffer));
+
+  // the status line and the headers end in the middle of a read, or on its boundary
+  client.chunk = GENERATE(1, 2, 5, 13, 64);
+  client.serve("ota.test", 80, "/app.ota",
+    "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nETag: \"abc\"\r\nContent-Encoding: gzip\r\n\r\nhello world");
+
+  REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+  REQUIRE(http.statusCode() == 200);
+  REQUIRE(http.contentLength() == 11);
+  REQUIRE(std::string(http.etag()) == "\"abc\"");
+  REQUIRE(http.gzip());
+  REQUIRE_FALSE(http.chunked());
+  REQUIRE(http.keepAlive());
+  REQUIRE(body(http, buffer, client) == "hello world");
+}
+
+TEST_CASE("An invalid status line is rejected", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  OtaHttpClient http(buffer, sizeof(buffer));
+
+  client.chunk = GENERATE(1, 64);
+
+  SECTION("the status code is not a number")
+  {
+    client.serve("ota.test", 80, "/app.ota", "HTTP/1.1 2x0 OK\r\nContent-Length: 0\r\n\r\n");
+  }
+
+  SECTION("the status code is missing")
+  {
+    client.serve("ota.test", 80, "/app.ota", "HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+  }
+
+  SECTION("the content length is not a number")
+  {
+    client.serve("ota.test", 80, "/app.ota", "HTTP/1.1 200 OK\r\nContent-Length: 12x\r\n\r\n");
+  }
+
+  REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::InvalidResponse);
+}
+
+TEST_CASE("A body without Content-Length is not skipped", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  OtaHttpClient http(buffer, sizeof(buffer));
+
+  SECTION("chunked transfer encoding")
+  {
+    client.serve("ota.test", 80, "/app.ota",
+      "HTTP/1.1 302 Found\r\nLocation: /v2\r\nTransfer-Encoding: gzip, chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n");
+
+    REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+    REQUIRE(http.chunked());
+  }
+
+  SECTION("no Content-Length")
+  {
+    client.serve("ota.test", 80, "/app.ota", "HTTP/1.1 302 Found\r\nLocation: /v2\r\n\r\nhello");
+
+    REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+    REQUIRE_FALSE(http.chunked());
+  }
+
+  REQUIRE(http.contentLength() == (int32_t)OtaHttpClient::NO_CONTENT_LENGTH);
+  REQUIRE(http.keepAlive());
+  REQUIRE_FALSE(http.skipBody(client, TIMEOUT_ms));
+}
+
+TEST_CASE("Overlong and folded header lines are skipped", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  char location[16];
+  OtaHttpClient http(buffer, sizeof(buffer));
+  std::string headers;
+
+  http.setLocationBuffer(location, sizeof(location));
+
+  SECTION("a name longer than the buffer")
+  {
+    headers = std::string(300, 'X') + ": 99\r\n";
+  }
+
+  SECTION("a value longer than the buffer")
+  {
+    headers = "X-Padding: " + std::string(5000, 'a') + "\r\n";
+  }
+
+  SECTION("a name starting with a known one")
+  {
+    headers = "Content-Length-Extra: 99\r\nConnection-Extra: close\r\n";
+  }
+
+  SECTION("a folded continuation line")
+  {
+    headers = "X-Folded: a\r\n Content-Length: 99\r\n\tConnection: close\r\n";
+  }
+
+  SECTION("a line without a colon")
+  {
+    headers = "Content-Length 99\r\n";
+  }
+
+  client.serve("ota.test", 80, "/app.ota", "HTTP/1.1 200 OK\r\n" + headers + "Content-Length: 5\r\n\r\nhello");
+
+  REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+  REQUIRE(http.statusCode() == 200);
+  REQUIRE(http.contentLength() == 5);
+  REQUIRE(http.keepAlive());
+  REQUIRE(body(http, buffer, client) == "hello");
+}
+
+TEST_CASE("A location longer than its buffer is reported as truncated", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  char location[16];
+  OtaHttpClient http(buffer, sizeof(buffer));
+
+  http.setLocationBuffer(location, sizeof(location));
+  client.serve("ota.test", 80, "/app.ota", MockClient::redirect(302, "/" + std::string(100, 'a')));
+
+  REQUIRE(http.get(client, "ota.test", 80, "/app.ota", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+  REQUIRE(http.locationTruncated());
+  REQUIRE(strlen(location) == sizeof(location) - 1);
+}
+
+TEST_CASE("The connection is reused only when the server keeps it alive", "[OtaHttpClient]")
+{
+  MockClient client;
+  uint8_t buffer[64];
+  OtaHttpClient http(buffer, sizeof(buffer));
+  std::string connection;
+  bool keep_alive;
+
+  SECTION("by default")
+  {
+    keep_alive = true;
+  }
+
+  SECTION("Connection: keep-alive")
+  {
+    connection = "Connection: keep-alive\r\n";
+    keep_alive = true;
+  }
+
+  SECTION("Connection: close")
+  {
+    connection = "Connection: Close\r\n";
+    keep_alive = false;
+  }
+
+  SECTION("Connection: close in a list")
+  {
+    connection = "Connection: upgrade, close\r\n";
+    keep_alive = false;
+  }
+
+  SECTION("Connection: close before another token")
+  {
+    connection = "Connection: close, upgrade\r\n";
+    keep_alive = false;
+  }
+
+  SECTION("Connection: a token starting with close")
+  {
+    connection = "Connection: closed, xclose\r\n";
+    keep_alive = true;
+  }
+
+  client.serve("ota.test", 80, "/a", "HTTP/1.1 200 OK\r\n" + connection + "Content-Length: 3\r\n\r\naaa");
+  client.serve("ota.test", 80, "/b", MockClient::response(200, "", {'b'}));
+
+  REQUIRE(http.get(client, "ota.test", 80, "/a", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+  REQUIRE(http.keepAlive() == keep_alive);
+  REQUIRE(http.skipBody(client, TIMEOUT_ms) == keep_alive);
+
+  // the caller closes a connection that cannot be reused
+  if(!keep_alive) {
+    client.stop();
+  }
+
+  REQUIRE(http.get(client, "ota.test", 80, "/b", nullptr, TIMEOUT_ms) == OtaHttpClient::Success);
+  REQUIRE(body(http, buffer, client) == "b");
+  REQUIRE(client.connections == (keep_alive ? 1 : 2));
+}
+
+TEST_CASE("The body of a redirect is skipped to reuse the connection", "[OtaHttpClient]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::string redirect;
+  int connections;
+
+  SECTION("an empty body")
+  {
+    redirect = MockClient::redirect(302, "/v2/app.ota");
+    connections = 1;
+  }
+
+  SECTION("a short body, received a few bytes at a time")
+  {
+    redirect = MockClient::response(302, "Location: /v2/app.ota\r\n", std::vector<uint8_t>(500, 'r'));
+    client.chunk = 7;
+    connections = 1;
+  }
+
+  SECTION("a body too long to be skipped")
+  {
+    redirect = MockClient::response(302, "Location: /v2/app.ota\r\n",
+      std::vector<uint8_t>((size_t)OtaHttpClient::MAX_SKIPPED_BODY + 1, 'r'));
+    connections = 2;
+  }
+
+  SECTION("a connection closed by the server")
+  {
+    redirect = MockClient::response(302, "Location: /v2/app.ota\r\nConnection: close\r\n", {'r'});
+    connections = 2;
+  }
+
+  client.serve("ota.test", 80, "/app.ota", redirect);
+  client.serve("ota.test", 80, "/v2/app.ota", MockClient::response(200, "", ota_image(ota_compress(app))));
+  ota.setClient(&client);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download("http://ota.test/app.ota") == (int)app.size());
+  REQUIRE(client.connections == connections);
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
@@ -0,0 +1,147 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A manifest published as a release asset is followed to the image", "[Manifest]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+  uint32_t crc32 = image[4] | (image[5] << 8) | (image[6] << 16) | ((uint32_t)image[7] << 24);
+  char line[128];
+
+  snprintf(line, sizeof(line), "0x%08X 1.1.0 - lzss %u %08x https://github.test/board/releases/download/v1.1.0/app.ota\n",
+    (unsigned int)TEST_MAGIC, (unsigned int)image.size(), (unsigned int)crc32);
+  std::string manifest = std::string("# magic version base codec size crc32 url\n") + line;
+
+  // release assets are redirected to the storage server
+  client.serve("github.test", 443, "/board/releases/latest/download/manifest.txt",
+    MockClient::redirect(302, "https://objects.test/assets/manifest.txt?sig=1"));
+  client.serve("objects.test", 443, "/assets/manifest.txt?sig=1",
+    MockClient::response(200, "", std::vector<uint8_t>(manifest.begin(), manifest.end())));
+  client.serve("github.test", 443, "/board/releases/download/v1.1.0/app.ota",
+    MockClient::redirect(302, "https://objects.test/assets/app.ota?sig=2"));
+  client.serve("objects.test", 443, "/assets/app.ota?sig=2", MockClient::response(200, "", image));
+
+  ota.setClient(&client);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  SECTION("with the running version")
+  {
+    ota.setRunningVersion(1, 0, 0);
+
+    REQUIRE(ota.startManifestDownload("https://github.test/board/releases/latest/download/manifest.txt") == (int)image.size());
+    REQUIRE(client.requests.size() == 4);
+
+    int res;
+    while((res = ota.downloadPoll()) == 0) { }
+
+    REQUIRE(res == 1);
+    REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+  }
+
+  SECTION("already running the newest version")
+  {
+    ota.setRunningVersion(1, 1, 0);
+
+    REQUIRE(ota.startManifestDownload("https://github.test/board/releases/latest/download/manifest.txt") ==
+      static_cast<int>(Arduino_ESP32_OTA::Error::OtaNoUpdate));
+    REQUIRE(client.requests.size() == 2);
+  }
+
+  SECTION("without the running version")
+  {
+    REQUIRE(ota.startManifestDownload("https://github.test/board/releases/latest/download/manifest.txt") ==
+      static_cast<int>(Arduino_ESP32_OTA::Error::OtaRunningVersion));
+    REQUIRE(client.requests.empty());
+  }
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("An image listed with codec none is written as it is", "[Manifest]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image;
+  int expected;
+  char line[128];
+
+  SECTION("an uncompressed payload")
+  {
+    image = ota_image(app);
+    expected = 1;
+  }
+
+  SECTION("a deflate payload")
+  {
+    image = ota_image(zlib_compress(app), Arduino_ESP32_OTA::PayloadFlagDeflate);
+    expected = static_cast<int>(Arduino_ESP32_OTA::Error::OtaManifest);
+  }
+
+  uint32_t crc32 = image[4] | (image[5] << 8) | (image[6] << 16) | ((uint32_t)image[7] << 24);
+  snprintf(line, sizeof(line), "0x%08X 1.1.0 - none %u %08x http://ota.test/app.bin\n",
+    (unsigned int)TEST_MAGIC, (unsigned int)image.size(), (unsigned int)crc32);
+  std::string manifest = line;
+
+  client.serve("ota.test", 80, "/manifest.txt",
+    MockClient::response(200, "", std::vector<uint8_t>(manifest.begin(), manifest.end())));
+  client.serve("ota.test", 80, "/app.bin", MockClient::response(200, "", image));
+
+  ota.setClient(&client);
+  ota.setRunningVersion(1, 0, 0);
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  REQUIRE(ota.startManifestDownload("http://ota.test/manifest.txt") == (int)image.size());
+
+  int res;
+  while((res = ota.downloadPoll()) == 0) { }
+
+  REQUIRE(res == expected);
+
+  if(expected == 1) {
+    REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+  } else {
+    REQUIRE(esp_partition_emulation_boot() == nullptr);
+  }
+
+  esp_partition_emulation_end();
+}
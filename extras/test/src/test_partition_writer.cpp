@@ -0,0 +1,272 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static const esp_partition_t small_table[] = {
+  { ESP_PARTITION_TYPE_APP,  ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x010000, 0x010000, SPI_FLASH_SEC_SIZE, "app0", false },
+  { ESP_PARTITION_TYPE_APP,  ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x020000, 0x010000, SPI_FLASH_SEC_SIZE, "app1", false },
+  { ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT,  0x030000, 0x010000, SPI_FLASH_SEC_SIZE, "ffat", false },
+};
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("An image is written to the partition and selected for boot", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> image = app_image(10000);
+  OtaPartitionWriter writer;
+
+  REQUIRE(writer.begin(partition));
+  REQUIRE(writer.write(image.data(), 5000));
+
+  WHEN("the image is incomplete")
+  {
+    THEN("its first bytes are still erased")
+    {
+      writer.write(image.data() + 5000, 5000);
+      REQUIRE(read_partition(partition, 0, OtaPartitionWriter::HEADER_SIZE) ==
+        std::vector<uint8_t>(OtaPartitionWriter::HEADER_SIZE, 0xFF));
+      REQUIRE(esp_partition_emulation_boot() == nullptr);
+    }
+  }
+
+  WHEN("the image is completed")
+  {
+    for(size_t i = 5000; i < image.size(); i++) {
+      REQUIRE(writer.write(image[i]));
+    }
+
+    REQUIRE(writer.end());
+    REQUIRE(read_partition(partition, 0, image.size()) == image);
+    REQUIRE(esp_partition_emulation_boot() == partition);
+  }
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("Sectors that already have the right content are not erased", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> image = app_image(5 * OtaPartitionWriter::SECTOR_SIZE);
+  OtaPartitionWriter writer;
+
+  REQUIRE(writer.begin(partition));
+  REQUIRE(writer.write(image.data(), image.size()));
+  REQUIRE(writer.end());
+
+  uint32_t erases = esp_partition_emulation_erases();
+
+  REQUIRE(writer.begin(partition));
+  REQUIRE(writer.write(image.data(), image.size()));
+  REQUIRE(writer.end());
+
+  // the first sector holds the header, it is always rewritten
+  REQUIRE(writer.skippedSectors() == 4);
+  REQUIRE(esp_partition_emulation_erases() == erases + 1);
+  REQUIRE(read_partition(partition, 0, image.size()) == image);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("Skipped bytes are left erased without programming them", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> image = app_image(6 * OtaPartitionWriter::SECTOR_SIZE + 100);
+  size_t const skipped = 3 * OtaPartitionWriter::SECTOR_SIZE + 200;
+  size_t const offset = 1000;
+  OtaPartitionWriter writer;
+
+  std::fill(image.begin() + offset, image.begin() + offset + skipped, 0xFF);
+
+  // a previous image, the skipped sectors are not erased
+  std::vector<uint8_t> const dirty(image.size(), 0x5A);
+  REQUIRE(esp_partition_write(partition, 0, dirty.data(), dirty.size()) == ESP_OK);
+
+  SECTION("all the bytes are written")
+  {
+    uint32_t const writes = esp_partition_emulation_writes();
+
+    REQUIRE(writer.begin(partition));
+    REQUIRE(writer.write(image.data(), image.size()));
+    REQUIRE(writer.end());
+
+    REQUIRE(esp_partition_emulation_writes() - writes == 8);
+  }
+
+  SECTION("the erased bytes are skipped")
+  {
+    uint32_t const writes = esp_partition_emulation_writes();
+
+    REQUIRE(writer.begin(partition));
+    REQUIRE(writer.write(image.data(), offset));
+    REQUIRE(writer.skip(skipped));
+    REQUIRE(writer.write(image.data() + offset + skipped, image.size() - offset - skipped));
+    REQUIRE(writer.end());
+
+    // the sectors only made of skipped bytes are erased, not programmed
+    REQUIRE(esp_partition_emulation_writes() - writes == 6);
+  }
+
+  REQUIRE(read_partition(partition, 0, image.size()) == image);
+  REQUIRE(esp_partition_emulation_boot() == partition);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A buffer that is not word aligned is rejected", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> image = app_image(2 * OtaPartitionWriter::SECTOR_SIZE);
+  alignas(4) static uint8_t buffer[OtaPartitionWriter::SECTOR_SIZE + 4];
+  OtaPartitionWriter writer;
+
+  SECTION("the writer")
+  {
+    REQUIRE_FALSE(writer.begin(partition, buffer + GENERATE(1, 2, 3)));
+    REQUIRE_FALSE(writer.isRunning());
+
+    REQUIRE(writer.begin(partition, buffer + 4));
+    REQUIRE(writer.write(image.data(), image.size()));
+    REQUIRE(writer.end());
+    REQUIRE(read_partition(partition, 0, image.size()) == image);
+  }
+
+  SECTION("the buffer given to the library")
+  {
+    Arduino_ESP32_OTA ota;
+
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterPartition, buffer + 2);
+    REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::OtaStorageInit);
+
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterPartition, buffer);
+    REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  }
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("Bytes past the end of the partition are dropped", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin", small_table, 3));
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  std::vector<uint8_t> image = app_image(partition->size + 3 * OtaPartitionWriter::SECTOR_SIZE);
+  OtaPartitionWriter writer;
+
+  REQUIRE(writer.begin(partition));
+
+  size_t written = 0;
+  for(uint8_t c : image) {
+    if(!writer.write(c)) {
+      break;
+    }
+    written++;
+  }
+
+  REQUIRE(written < image.size());
+  REQUIRE(writer.hasError());
+
+  // nothing is written once the writer has failed
+  REQUIRE_FALSE(writer.write(image.data(), image.size()));
+  REQUIRE_FALSE(writer.skip(OtaPartitionWriter::SECTOR_SIZE));
+  REQUIRE_FALSE(writer.end());
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("An image larger than the partition fails the download", "[OtaPartitionWriter]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin", small_table, 3));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> image = ota_image(ota_compress(app_image(small_table[1].size + 1000)));
+  MemoryStream stream(image);
+
+  SECTION("written by the partition writer")
+  {
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterPartition);
+  }
+
+  SECTION("written by the Update library")
+  {
+    ota.setFlashWriter(Arduino_ESP32_OTA::FlashWriterUpdate);
+  }
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaStorageWrite));
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("FAT images are written at the same offset by both writers", "[OtaPartitionWriter]")
+{
+  const esp_partition_t* fat = &small_table[2];
+  std::vector<uint8_t> fs = app_image(3 * OtaPartitionWriter::SECTOR_SIZE + 100);
+  std::vector<uint8_t> image = ota_image(ota_compress(fs), Arduino_ESP32_OTA::PayloadTargetFilesystem << 4);
+  std::vector<uint8_t> content[2];
+  Arduino_ESP32_OTA::FlashWriter writers[2] = {
+    Arduino_ESP32_OTA::FlashWriterUpdate,
+    Arduino_ESP32_OTA::FlashWriterPartition
+  };
+
+  for(int i = 0; i < 2; i++) {
+    REQUIRE(esp_partition_emulation_begin("flash.bin", small_table, 3));
+
+    Arduino_ESP32_OTA ota;
+    MemoryStream stream(image);
+
+    ota.setFlashWriter(writers[i]);
+    REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+    REQUIRE(ota.download(stream, image.size()) == (int)fs.size());
+    REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+
+    content[i] = read_partition(fat, 0, fat->size);
+    esp_partition_emulation_end();
+  }
+
+  // the first sector of the FAT partition is not part of the image
+  REQUIRE(std::vector<uint8_t>(content[0].begin(), content[0].begin() + 0x1000) ==
+    std::vector<uint8_t>(0x1000, 0xFF));
+  REQUIRE(std::vector<uint8_t>(content[0].begin() + 0x1000, content[0].begin() + 0x1000 + fs.size()) == fs);
+  REQUIRE(content[1] == content[0]);
+}
@@ -0,0 +1,90 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("A redirect location is resolved against the current url", "[Redirect]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::string image = MockClient::response(200, "", ota_image(ota_compress(app)));
+  std::string served;
+
+  SECTION("absolute url")
+  {
+    client.serve("ota.test", 80, "/fw/app.ota", MockClient::redirect(302, "http://cdn.test:8080/app.ota"));
+    client.serve("cdn.test", 8080, "/app.ota", image);
+    served = "cdn.test:8080 GET /app.ota ";
+  }
+
+  SECTION("network path reference")
+  {
+    client.serve("ota.test", 80, "/fw/app.ota", MockClient::redirect(302, "//cdn.test/app.ota"));
+    client.serve("cdn.test", 80, "/app.ota", image);
+    served = "cdn.test:80 GET /app.ota ";
+  }
+
+  SECTION("absolute path")
+  {
+    client.serve("ota.test", 80, "/fw/app.ota", MockClient::redirect(301, "/v2/app.ota"));
+    client.serve("ota.test", 80, "/v2/app.ota", image);
+    served = "ota.test:80 GET /v2/app.ota ";
+  }
+
+  SECTION("relative path")
+  {
+    client.serve("ota.test", 80, "/fw/app.ota", MockClient::redirect(307, "v2/app.ota#latest"));
+    client.serve("ota.test", 80, "/fw/v2/app.ota", image);
+    served = "ota.test:80 GET /fw/v2/app.ota ";
+  }
+
+  SECTION("query")
+  {
+    client.serve("ota.test", 80, "/fw/app.ota", MockClient::redirect(302, "?token=1"));
+    client.serve("ota.test", 80, "/fw/app.ota?token=1", image);
+    served = "ota.test:80 GET /fw/app.ota?token=1 ";
+  }
+
+  ota.setClient(&client);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download("http://ota.test/fw/app.ota") == (int)app.size());
+  REQUIRE(client.requests.size() == 2);
+  REQUIRE(client.requests[1].rfind(served, 0) == 0);
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
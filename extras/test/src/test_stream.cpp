@@ -0,0 +1,147 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+
+#include "ota_image.h"
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("An update is applied from a stream", "[Stream]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+
+  // the bytes become available a few at a time, as from a serial port
+  MemoryStream stream(image, 1000);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == (int)app.size());
+  REQUIRE(stream.position() == image.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+  REQUIRE(esp_partition_emulation_boot() == partition);
+  REQUIRE(read_partition(partition, 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("The bytes processed by a poll are limited by the byte budget", "[Stream]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  CountingOta ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+  MemoryStream stream(image);
+  uint32_t const budget = GENERATE(1, 100, 1000);
+  size_t polls = 0;
+  int res;
+
+  ota.setPollBudget(budget);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.startDownload(stream, image.size()) == (int)image.size());
+
+  do {
+    size_t written = ota.written;
+    res = ota.downloadPoll();
+    polls++;
+    REQUIRE(ota.written - written <= budget);
+  } while(res == 0);
+
+  // the stream is read in blocks of ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE bytes,
+  // each of them is processed by several polls
+  REQUIRE(res == 1);
+  REQUIRE(polls >= image.size() / budget);
+  REQUIRE(ota.written == app.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A truncated stream fails after the receive timeout", "[Stream]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> image = ota_image(ota_compress(app_image(20000)));
+  std::vector<uint8_t> truncated(image.begin(), image.begin() + image.size() / 2);
+  MemoryStream stream(truncated);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.startDownload(stream, image.size()) == (int)image.size());
+
+  // the polls never wait for the bytes that are missing
+  for(int i = 0; i < 10 || stream.position() < truncated.size(); i++) {
+    unsigned long start = millis();
+    REQUIRE(ota.downloadPoll() == 0);
+    REQUIRE(millis() - start < 100);
+  }
+
+  mock_advance_time(ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms + 1);
+
+  REQUIRE(ota.downloadPoll() == static_cast<int>(Arduino_ESP32_OTA::Error::OtaDownload));
+  REQUIRE(esp_partition_emulation_boot() == nullptr);
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A stream shorter than the ota header is rejected", "[Stream]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> image = ota_image(ota_compress(app_image(100)));
+  std::vector<uint8_t> truncated(image.begin(), image.begin() + 10);
+  MemoryStream stream(truncated);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, truncated.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaHeaderLength));
+
+  esp_partition_emulation_end();
+}
+
+TEST_CASE("A filesystem image with a primed window is rejected", "[Stream]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  Arduino_ESP32_OTA ota;
+  uint8_t flags = Arduino_ESP32_OTA::PayloadFlagPrimedWindow | (Arduino_ESP32_OTA::PayloadTargetFilesystem << 4);
+  std::vector<uint8_t> image = ota_image(ota_compress(app_image(1000)), flags);
+  MemoryStream stream(image);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(ota.download(stream, image.size()) == static_cast<int>(Arduino_ESP32_OTA::Error::OtaDictionary));
+  REQUIRE(esp_partition_emulation_writes() == 0);
+
+  esp_partition_emulation_end();
+}
@@ -0,0 +1,208 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <Arduino_ESP32_OTA.h>
+#include <esp_ota_ops.h>
+#include <utility/token_bucket.h>
+
+#include "mock_client.h"
+#include "ota_image.h"
+
+/**************************************************************************************
+   CLASS DECLARATION
+ **************************************************************************************/
+
+// the clock only moves with mock_advance_time() while in scope
+struct FrozenTime {
+  FrozenTime() { mock_freeze_time(true); }
+  ~FrozenTime() { mock_freeze_time(false); }
+};
+
+/**************************************************************************************
+   TEST CODE
+ **************************************************************************************/
+
+TEST_CASE("The token bucket refills at the configured rate", "[TokenBucket]")
+{
+  FrozenTime frozen;
+  TokenBucket bucket;
+
+  bucket.configure(1000, 500);
+  bucket.reset(micros());
+
+  REQUIRE(bucket.available(micros()) == 500);
+  bucket.consume(500);
+  REQUIRE(bucket.available(micros()) == 0);
+
+  mock_advance_time(100);
+  REQUIRE(bucket.available(micros()) == 100);
+  bucket.consume(60);
+  REQUIRE(bucket.available(micros()) == 40);
+
+  // consuming more than available empties the bucket
+  bucket.consume(1000);
+  REQUIRE(bucket.available(micros()) == 0);
+
+  mock_advance_time(250);
+  REQUIRE(bucket.available(micros()) == 250);
+}
+
+TEST_CASE("The token bucket keeps the time of partial tokens", "[TokenBucket]")
+{
+  FrozenTime frozen;
+  TokenBucket bucket;
+
+  // one token every 100 ms
+  bucket.configure(10, 1);
+  bucket.reset(micros());
+  bucket.consume(1);
+
+  for(int i = 0; i < 9; i++) {
+    mock_advance_time(10);
+    REQUIRE(bucket.available(micros()) == 0);
+  }
+
+  mock_advance_time(10);
+  REQUIRE(bucket.available(micros()) == 1);
+}
+
+TEST_CASE("The token bucket never holds more than the burst", "[TokenBucket]")
+{
+  FrozenTime frozen;
+  TokenBucket bucket;
+
+  SECTION("an explicit burst")
+  {
+    bucket.configure(1000, 300);
+    bucket.reset(micros());
+    mock_advance_time(10000);
+
+    REQUIRE(bucket.available(micros()) == 300);
+  }
+
+  SECTION("the default burst is one second worth of tokens")
+  {
+    bucket.configure(1000, 0);
+    bucket.reset(micros());
+    mock_advance_time(10000);
+
+    REQUIRE(bucket.available(micros()) == 1000);
+  }
+
+  SECTION("a smaller burst configured while in use")
+  {
+    bucket.configure(1000, 800);
+    bucket.reset(micros());
+    bucket.configure(1000, 200);
+
+    REQUIRE(bucket.available(micros()) == 200);
+  }
+
+  SECTION("a long idle time after the bucket was emptied")
+  {
+    bucket.configure(1000, 300);
+    bucket.reset(micros());
+    bucket.consume(300);
+    mock_advance_time(3600UL * 1000);
+
+    REQUIRE(bucket.available(micros()) == 300);
+  }
+}
+
+TEST_CASE("A zero rate disables the limit", "[TokenBucket]")
+{
+  FrozenTime frozen;
+  TokenBucket bucket;
+
+  SECTION("never configured")
+  {
+  }
+
+  SECTION("configured with a zero rate")
+  {
+    bucket.configure(1000, 300);
+    bucket.configure(0, 300);
+  }
+
+  bucket.reset(micros());
+  bucket.consume(1000000);
+
+  REQUIRE(bucket.available(micros()) == (size_t)TokenBucket::UNLIMITED);
+}
+
+TEST_CASE("The download is limited to the configured rate", "[TokenBucket]")
+{
+  REQUIRE(esp_partition_emulation_begin("flash.bin"));
+
+  MockClient client;
+  Arduino_ESP32_OTA ota;
+  std::vector<uint8_t> app = app_image(20000);
+  std::vector<uint8_t> image = ota_image(ota_compress(app));
+  int downloaded;
+  int res = 0;
+
+  client.serve("ota.test", 80, "/app.ota", MockClient::response(200, "", image));
+  ota.setClient(&client);
+  ota.setRateLimit(1000, 300);
+
+  REQUIRE(ota.begin(TEST_MAGIC) == Arduino_ESP32_OTA::Error::None);
+
+  {
+    FrozenTime frozen;
+
+    REQUIRE(ota.startDownload("http://ota.test/app.ota") == (int)image.size());
+
+    // the bytes received with the headers are not limited
+    downloaded = ota.downloadProgress();
+
+    for(int i = 0; i < 10; i++) {
+      REQUIRE(ota.downloadPoll() == 0);
+    }
+    REQUIRE(ota.downloadProgress() == downloaded + 300);
+
+    mock_advance_time(100);
+    for(int i = 0; i < 10; i++) {
+      REQUIRE(ota.downloadPoll() == 0);
+    }
+    REQUIRE(ota.downloadProgress() == downloaded + 400);
+
+    mock_advance_time(10000);
+    for(int i = 0; i < 10; i++) {
+      REQUIRE(ota.downloadPoll() == 0);
+    }
+    REQUIRE(ota.downloadProgress() == downloaded + 700);
+  }
+
+  ota.setRateLimit(0);
+  while(res == 0) {
+    res = ota.downloadPoll();
+  }
+
+  REQUIRE(res == 1);
+  REQUIRE(ota.downloadProgress() == (int)image.size());
+  REQUIRE(ota.update() == Arduino_ESP32_OTA::Error::None);
+  REQUIRE(read_partition(esp_ota_get_next_update_partition(NULL), 0, app.size()) == app);
+
+  esp_partition_emulation_end();
+}
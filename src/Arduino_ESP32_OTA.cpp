@@ -21,7 +21,9 @@
 
 #include <Update.h>
 #include "Arduino_ESP32_OTA.h"
-#include "tls/amazon_root_ca.h"
+#if !defined(ARDUINO_ESP32_OTA_NO_TLS)
+  #include "tls/amazon_root_ca.h"
+#endif
 #include "esp_ota_ops.h"
 
 /******************************************************************************
@@ -31,17 +33,42 @@
 Arduino_ESP32_OTA::Arduino_ESP32_OTA()
 : _context(nullptr)
 , _client(nullptr)
-, _http_client(nullptr)
+, _stream(nullptr)
+, _user_client(nullptr)
+#if !defined(ARDUINO_ESP32_OTA_NO_TLS)
 ,_ca_cert{amazon_root_ca}
+#else
+,_ca_cert{nullptr}
+#endif
 ,_ca_cert_bundle{nullptr}
 ,_ca_cert_bundle_size(0)
+,_link_busy(false)
+,_accept_gzip(false)
+,_poll_budget_bytes(0)
+,_poll_budget_us(0)
+,_poll_max_us(0)
+,_heap_before_download(0)
+,_heap_min_free(0)
+,_erased_bytes(0)
+,_redirect_from(nullptr)
+,_redirect_to(nullptr)
+,_flash_writer(FlashWriterUpdate)
+,_flash_buffer(nullptr)
+,_decryption_key{nullptr}
+,_decryption_key_size(0)
 ,_magic(0)
+,_running_version(0)
+,_running_version_set(false)
+,_manifest_size(0)
+,_manifest_crc32(0)
+,_manifest_codec(0)
 {
 
 }
 
 Arduino_ESP32_OTA::~Arduino_ESP32_OTA(){
   clean();
+  clearRedirectCache();
 }
 
 /******************************************************************************
@@ -63,13 +90,32 @@ Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::begin(uint32_t magic)
     DEBUG_DEBUG("%s: Aborting running update", __FUNCTION__);
   }
 
-  if(!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+  if(_flash_writer == FlashWriterPartition) {
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+    /* drop a data partition closed by a bundle that has not been applied */
+    _partition_writer.abort();
+
+    if(!_partition_writer.begin(esp_ota_get_next_update_partition(NULL), _flash_buffer)) {
+      DEBUG_ERROR("%s: failed to initialize flash partition writer", __FUNCTION__);
+      return Error::OtaStorageInit;
+    }
+#else
+    DEBUG_ERROR("%s: the partition writer is disabled", __FUNCTION__);
+    return Error::OtaStorageInit;
+#endif
+  } else if(!Update.begin(UPDATE_SIZE_UNKNOWN)) {
     DEBUG_ERROR("%s: failed to initialize flash update", __FUNCTION__);
     return Error::OtaStorageInit;
   }
   return Error::None;
 }
 
+void Arduino_ESP32_OTA::setFlashWriter(FlashWriter writer, uint8_t * buffer)
+{
+  _flash_writer = writer;
+  _flash_buffer = buffer;
+}
+
 void Arduino_ESP32_OTA::setCACert (const char *rootCA)
 {
   if(rootCA != nullptr) {
@@ -92,274 +138,1080 @@ void Arduino_ESP32_OTA::setCACertBundle (const uint8_t * bundle, size_t size)
   }
 }
 
+void Arduino_ESP32_OTA::setClient(Client * client)
+{
+  _user_client = client;
+}
+
+void Arduino_ESP32_OTA::setAcceptGzip(bool accept)
+{
+  _accept_gzip = accept;
+}
+
+void Arduino_ESP32_OTA::setDecryptionKey(const uint8_t * key, size_t size)
+{
+  if(key != nullptr && size != 0) {
+    _decryption_key = key;
+    _decryption_key_size = size;
+  }
+}
+
+void Arduino_ESP32_OTA::setRateLimit(uint32_t bytes_per_second, uint32_t burst)
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+  _rate_limit.configure(bytes_per_second, burst);
+#else
+  (void)bytes_per_second;
+  (void)burst;
+#endif
+}
+
+void Arduino_ESP32_OTA::setLinkBusy(bool busy)
+{
+  _link_busy = busy;
+}
+
 void Arduino_ESP32_OTA::setMagic(uint32_t magic)
 {
   _magic = magic;
 }
 
+void Arduino_ESP32_OTA::setRunningVersion(uint8_t major, uint8_t minor, uint8_t patch)
+{
+  _running_version = OtaManifestParser::version(major, minor, patch);
+  _running_version_set = true;
+}
+
 void Arduino_ESP32_OTA::write_byte_to_flash(uint8_t data)
 {
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  if(_flash_writer == FlashWriterPartition) {
+    if(_partition_writer.isRunning()) {
+      _partition_writer.write(data);
+    }
+    return;
+  }
+#endif
+
   Update.write(&data, 1);
 }
 
+void Arduino_ESP32_OTA::write_erased_to_flash(uint32_t len)
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  if(_flash_writer == FlashWriterPartition) {
+    if(_partition_writer.isRunning()) {
+      _partition_writer.skip(len);
+    }
+    return;
+  }
+#endif
+
+  while(len-- > 0) {
+    write_byte_to_flash(0xFF);
+  }
+}
+
 int Arduino_ESP32_OTA::startDownload(const char * ota_url)
+{
+  int res;
+
+  if(_redirect_from != nullptr && strcmp(_redirect_from, ota_url) == 0) {
+    // skip the redirects followed by the previous download of the same url
+    if((res = requestDownload(_redirect_to)) >= 0) {
+      return res;
+    }
+
+    // the resolved location may have expired, follow the redirects again
+    DEBUG_VERBOSE("OTA: cached location \"%s\" failed, requesting \"%s\"", _redirect_to, ota_url);
+    clearRedirectCache();
+  }
+
+  res = requestDownload(ota_url);
+
+  if(res >= 0 && strcmp(_context->url, ota_url) != 0) {
+    cacheRedirect(ota_url, _context->url);
+  }
+
+  return res;
+}
+
+int Arduino_ESP32_OTA::startManifestDownload(const char * manifest_url)
 {
   assert(_context == nullptr);
   assert(_client == nullptr);
-  assert(_http_client == nullptr);
 
+#if defined(ARDUINO_ESP32_OTA_NO_MANIFEST)
+  (void)manifest_url;
+  DEBUG_VERBOSE("OTA ERROR: manifests are disabled");
+  return static_cast<int>(Error::OtaManifest);
+#else
   Error err = Error::None;
-  int statusCode;
   int res;
+  uint8_t codecs = 0;
+  int32_t remaining;
+  unsigned long start;
+
+  // without the running version the newest image would be installed on every check
+  if(!_running_version_set) {
+    DEBUG_VERBOSE("OTA ERROR: setRunningVersion() must be called before startManifestDownload()");
+    return static_cast<int>(Error::OtaRunningVersion);
+  }
 
-  _context = new Context(ota_url, [this](uint8_t data){
-    _context->writtenBytes++;
-    write_byte_to_flash(data);
-  });
-
-  if(strcmp(_context->parsed_url.schema(), "http") == 0) {
-    _client = new WiFiClient();
-  } else if(strcmp(_context->parsed_url.schema(), "https") == 0) {
-    _client = new WiFiClientSecure();
-    if (_ca_cert != nullptr) {
-      static_cast<WiFiClientSecure*>(_client)->setCACert(_ca_cert);
-    }
-#if (ESP_ARDUINO_VERSION < ESP_ARDUINO_VERSION_VAL(3, 0, 4))
-    else if (_ca_cert_bundle != nullptr) {
-      static_cast<WiFiClientSecure*>(_client)->setCACertBundle(_ca_cert_bundle);
-    }
-#else
-    else if (_ca_cert_bundle != nullptr && _ca_cert_bundle_size != 0) {
-      static_cast<WiFiClientSecure*>(_client)->setCACertBundle(_ca_cert_bundle, _ca_cert_bundle_size);
-    }
+  // images stored as they are can be written by any build
+  codecs |= 1 << OtaManifestParser::CodecNone;
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  codecs |= 1 << OtaManifestParser::CodecLZSS;
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  codecs |= 1 << OtaManifestParser::CodecDeflate;
 #endif
-    else {
-      DEBUG_VERBOSE("%s: CA not configured for download client");
-    }
-  } else {
-    err = Error::UrlParseError;
-    goto exit;
-  }
 
-  _http_client = new HttpClient(*_client, _context->parsed_url.host(), _context->parsed_url.port());
+  OtaManifestParser manifest(_magic, _running_version, codecs);
 
-  res= _http_client->get(_context->parsed_url.path());
+  // the manifest is requested as the images are, e.g. release assets redirected to a cdn
+  newContext(manifest_url);
 
-  if(res == HTTP_ERROR_CONNECTION_FAILED) {
-    DEBUG_VERBOSE("OTA ERROR: http client error connecting to server \"%s:%d\"",
-      _context->parsed_url.host(), _context->parsed_url.port());
-    err = Error::ServerConnectError;
-    goto exit;
-  } else if(res == HTTP_ERROR_TIMED_OUT) {
-    DEBUG_VERBOSE("OTA ERROR: http client timeout \"%s\"", _context->url);
-    err = Error::OtaHeaderTimeout;
-    goto exit;
-  } else if(res != HTTP_SUCCESS) {
-    DEBUG_VERBOSE("OTA ERROR: http client returned %d on  get \"%s\"", res, _context->url);
-    err = Error::OtaDownload;
+  if((err = requestUrl()) != Error::None) {
     goto exit;
   }
 
-  statusCode = _http_client->responseStatusCode();
-
-  if(statusCode != 200) {
-    DEBUG_VERBOSE("OTA ERROR: get response on \"%s\" returned status %d", _context->url, statusCode);
+  if(_context->http.chunked() || _context->http.gzip()) {
+    DEBUG_VERBOSE("OTA ERROR: manifest \"%s\" has an unsupported transfer or content encoding", _context->url);
     err = Error::HttpResponse;
     goto exit;
   }
 
-  // The following call is required to save the header value , keep it
-  if(_http_client->contentLength() == HttpClient::kNoContentLengthHeader) {
-    DEBUG_VERBOSE("OTA ERROR: the response header doesn't contain \"ContentLength\" field");
-    err = Error::HttpHeaderError;
+  // the manifest is parsed while it is received, without storing it
+  manifest.parse(_context->buffer, _context->http.bodyAvailable());
+
+  remaining = _context->http.contentLength() == OtaHttpClient::NO_CONTENT_LENGTH ?
+    INT32_MAX : _context->http.contentLength() - _context->http.bodyAvailable();
+  start = millis();
+
+  while(remaining > 0) {
+    int len = _client->read(_context->buffer, (size_t)remaining < sizeof(_context->buffer) ? remaining : sizeof(_context->buffer));
+
+    if(len > 0) {
+      manifest.parse(_context->buffer, len);
+      remaining -= len;
+      start = millis();
+    } else if(!_client->connected() && _client->available() <= 0) {
+      break;
+    } else if(millis() - start > ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms) {
+      err = Error::OtaManifest;
+      goto exit;
+    } else {
+      delay(1);
+    }
+  }
+
+  if(remaining > 0 && _context->http.contentLength() != OtaHttpClient::NO_CONTENT_LENGTH) {
+    DEBUG_VERBOSE("OTA ERROR: manifest \"%s\" is incomplete", _context->url);
+    err = Error::OtaManifest;
     goto exit;
   }
 
-exit:
-  if(err != Error::None) {
-    clean();
-    return static_cast<int>(err);
-  } else {
-    return _http_client->contentLength();
+  manifest.end();
+  clean();
+
+  if(!manifest.found()) {
+    DEBUG_VERBOSE("OTA: no image in \"%s\" for magic 0x%08X", manifest_url, (unsigned int)_magic);
+    return static_cast<int>(Error::OtaNoUpdate);
   }
+
+  DEBUG_VERBOSE("OTA: manifest selected \"%s\"", manifest.url());
+
+  _manifest_size = manifest.image().size;
+  _manifest_crc32 = manifest.image().crc32;
+  _manifest_codec = manifest.image().codec;
+
+  res = startDownload(manifest.url());
+
+  _manifest_size = 0;
+  _manifest_crc32 = 0;
+  _manifest_codec = 0;
+
+  return res;
+
+exit:
+  clean();
+  return static_cast<int>(err);
+#endif
 }
 
-int Arduino_ESP32_OTA::downloadPoll()
+int Arduino_ESP32_OTA::startDownload(Stream & stream, size_t size)
 {
-  int http_res =  static_cast<int>(Error::None);;
-  int res = 0;
+  assert(_context == nullptr);
+  assert(_client == nullptr);
 
-  if(_http_client->available() == 0) {
-    goto exit;
-  }
+  _heap_before_download = _heap_min_free = ESP.getFreeHeap();
 
-  http_res = _http_client->read(_context->buffer, _context->buf_len);
+  newContext(nullptr);
 
-  if(http_res < 0) {
-    DEBUG_VERBOSE("OTA ERROR: Download read error %d", http_res);
-    res = static_cast<int>(Error::OtaDownload);
-    goto exit;
+  // the small buffer of the context is used if the block cannot be allocated
+  uint8_t * block = (uint8_t*)malloc(ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE);
+  if(block != nullptr) {
+    _context->block = block;
+    _context->block_len = ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE;
   }
 
-  for(uint8_t* cursor=(uint8_t*)_context->buffer; cursor<_context->buffer+http_res; ) {
-    switch(_context->downloadState) {
-    case OtaDownloadHeader: {
-      uint32_t copied = http_res < sizeof(_context->header.buf) ? http_res : sizeof(_context->header.buf);
-      memcpy(_context->header.buf+_context->headerCopiedBytes, _context->buffer, copied);
-      cursor += copied;
-      _context->headerCopiedBytes += copied;
+  _context->contentLength = size;
+  _context->lastReceived = millis();
+  _stream = &stream;
+  _poll_max_us = 0;
+  _erased_bytes = 0;
 
-      // when finished go to next state
-      if(sizeof(_context->header.buf) == _context->headerCopiedBytes) {
-        _context->downloadState = OtaDownloadFile;
+  sampleHeap();
 
-        _context->calculatedCrc32 = crc_update(
-          _context->calculatedCrc32,
-          &(_context->header.header.magic_number),
-          sizeof(_context->header) - offsetof(OtaHeader, header.magic_number)
-        );
+  return size;
+}
 
-        if(_context->header.header.magic_number != _magic) {
-          _context->downloadState = OtaDownloadMagicNumberMismatch;
-          res = static_cast<int>(Error::OtaHeaderMagicNumber);
+int Arduino_ESP32_OTA::requestDownload(const char * url)
+{
+  assert(_context == nullptr);
+  assert(_client == nullptr);
 
-          goto exit;
-        }
-      }
+  Error err = Error::None;
 
-      break;
-    }
-    case OtaDownloadFile:
-      _context->decoder.decompress(cursor, http_res - (cursor-_context->buffer)); // TODO verify return value
+  _heap_before_download = _heap_min_free = ESP.getFreeHeap();
 
-      _context->calculatedCrc32 = crc_update(
-          _context->calculatedCrc32,
-          cursor,
-          http_res - (cursor-_context->buffer)
-        );
+  newContext(url);
 
-      cursor += http_res - (cursor-_context->buffer);
-      _context->downloadedSize += (cursor-_context->buffer);
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if(_accept_gzip) {
+    _context->http.setAcceptEncoding("gzip, identity");
+  }
+#endif
 
-      // TODO there should be no more bytes available when the download is completed
-      if(_context->downloadedSize == _http_client->contentLength()) {
-        _context->downloadState = OtaDownloadCompleted;
-        res = 1;
-      }
+  if((err = requestUrl()) != Error::None) {
+    goto exit;
+  }
 
-      if(_context->downloadedSize > _http_client->contentLength()) {
-        _context->downloadState = OtaDownloadError;
-        res = static_cast<int>(Error::OtaDownload);
-      }
-      // TODO fail if we exceed a timeout? and available is 0 (client is broken)
-      break;
-    case OtaDownloadCompleted:
-      res = 1;
-      goto exit;
-    default:
-      _context->downloadState = OtaDownloadError;
-      res = static_cast<int>(Error::OtaDownload);
-      goto exit;
-    }
+  if(_context->http.contentLength() == OtaHttpClient::NO_CONTENT_LENGTH) {
+    DEBUG_VERBOSE("OTA ERROR: the response header doesn't contain \"ContentLength\" field");
+    err = Error::HttpHeaderError;
+    goto exit;
   }
 
-exit:
-  if(_context->downloadState == OtaDownloadError ||
-      _context->downloadState == OtaDownloadMagicNumberMismatch) {
-    clean(); // need to clean everything because the download failed
-  } else if(_context->downloadState == OtaDownloadCompleted) {
-    // only need to delete clients and not the context, since it will be needed
-    if(_client != nullptr) {
-      delete _client;
-      _client = nullptr;
+  // the image selected from a manifest is rejected before its payload is transferred
+  if(_manifest_size != 0) {
+    if(!_context->http.gzip() && (uint32_t)_context->http.contentLength() != _manifest_size) {
+      DEBUG_VERBOSE("OTA ERROR: \"%s\" size %d does not match the manifest", _context->url, (int)_context->http.contentLength());
+      err = Error::OtaManifest;
+      goto exit;
     }
 
-    if(_http_client != nullptr) {
-      delete _http_client;
-      _http_client = nullptr;
-    }
+    _context->checkExpectedCrc32 = true;
+    _context->expectedCrc32 = _manifest_crc32;
+    _context->raw = _manifest_codec == OtaManifestParser::CodecNone;
   }
 
-  return res;
-}
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if(_context->http.gzip()) {
+    _context->content_inflater = new InflateDecoder([this](const uint8_t* data, uint32_t len){
+      // the payload may be decrypted in place, the inflate window must not be modified
+      uint8_t chunk[64];
+
+      while(len > 0) {
+        uint32_t chunk_len = len < sizeof(chunk) ? len : sizeof(chunk);
+        memcpy(chunk, data, chunk_len);
+        data += chunk_len;
+        len -= chunk_len;
+
+        int res = processPayload(chunk, chunk + chunk_len);
+        if(res < 0) {
+          _context->error = static_cast<Error>(res);
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+#else
+  if(_context->http.gzip()) {
+    DEBUG_VERBOSE("OTA ERROR: gzip content encoding is disabled");
+    err = Error::OtaCompression;
+    goto exit;
+  }
+#endif
 
-int Arduino_ESP32_OTA::downloadProgress()
-{
-  if(_context->error != Error::None) {
-    return static_cast<int>(_context->error);
+  // the first bytes of the body have been received together with the headers
+  _context->contentLength = _context->http.contentLength();
+  _context->bufferedBytes = _context->http.bodyAvailable();
+  _context->downloadedSize = _context->bufferedBytes;
+  _context->lastReceived = millis();
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+  _rate_limit.reset(micros());
+#endif
+  _poll_max_us = 0;
+  _erased_bytes = 0;
+
+exit:
+  if(err != Error::None) {
+    clean();
+    return static_cast<int>(err);
   } else {
-    return _context->downloadedSize;
+    return _context->http.contentLength();
   }
 }
 
-size_t Arduino_ESP32_OTA::downloadSize()
+Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::requestUrl()
 {
-  return _http_client!=nullptr ? _http_client->contentLength() : 0;
-}
+  Error err = Error::None;
+  int statusCode;
+  int res;
+  int redirects = 0;
+  char * location = (char*)malloc(ARDUINO_ESP32_OTA_MAX_LOCATION_LENGTH);
 
-int Arduino_ESP32_OTA::download(const char * ota_url)
-{
-  int err = startDownload(ota_url);
+  _context->http.setLocationBuffer(location, location != nullptr ? ARDUINO_ESP32_OTA_MAX_LOCATION_LENGTH : 0);
 
-  if(err < 0) {
-    return err;
-  }
+  for(;;) {
+    if(_client == nullptr && (_client = newClient(_context->parsed_url->schema())) == nullptr) {
+      err = Error::UrlParseError;
+      goto exit;
+    }
 
-  int res = 0;
-  while((res = downloadPoll()) <= 0);
+    res = _context->http.get(*_client,
+      _context->parsed_url->host(), _context->parsed_url->port(),
+      _context->parsed_url->path(), _context->parsed_url->query(),
+      ARDUINO_ESP32_OTA_HTTP_HEADER_RECEIVE_TIMEOUT_ms);
 
-  return res == 1? _context->writtenBytes : res;
-}
+    // the TLS session buffers are allocated during the handshake
+    sampleHeap();
 
-void Arduino_ESP32_OTA::clean()
-{
-  if(_client != nullptr) {
-    delete _client;
-    _client = nullptr;
-  }
+    if(res == OtaHttpClient::ConnectionFailed) {
+      DEBUG_VERBOSE("OTA ERROR: http client error connecting to server \"%s:%d\"",
+        _context->parsed_url->host(), _context->parsed_url->port());
+      err = Error::ServerConnectError;
+      goto exit;
+    } else if(res == OtaHttpClient::TimedOut) {
+      DEBUG_VERBOSE("OTA ERROR: http client timeout \"%s\"", _context->url);
+      err = Error::OtaHeaderTimeout;
+      goto exit;
+    } else if(res != OtaHttpClient::Success) {
+      DEBUG_VERBOSE("OTA ERROR: http client returned %d on  get \"%s\"", res, _context->url);
+      err = Error::ParseHttpHeader;
+      goto exit;
+    }
 
-  if(_http_client != nullptr) {
-    delete _http_client;
-    _http_client = nullptr;
-  }
+    statusCode = _context->http.statusCode();
 
-  if(_context != nullptr) {
-    delete _context;
-    _context = nullptr;
-  }
-}
+    if(statusCode == 301 || statusCode == 302 || statusCode == 303 ||
+       statusCode == 307 || statusCode == 308) {
+      if(++redirects > ARDUINO_ESP32_OTA_MAX_REDIRECTS) {
+        DEBUG_VERBOSE("OTA ERROR: too many redirects requesting \"%s\"", _context->url);
+        err = Error::HttpResponse;
+        goto exit;
+      }
 
-Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::verify()
-{
-  assert(_context != nullptr);
+      if(location == nullptr || location[0] == '\0' || _context->http.locationTruncated()) {
+        DEBUG_VERBOSE("OTA ERROR: invalid redirect location from \"%s\"", _context->url);
+        err = Error::HttpHeaderError;
+        goto exit;
+      }
 
-  /* ... then finalize ... */
-  _context->calculatedCrc32 ^= 0xFFFFFFFF;
+      DEBUG_VERBOSE("OTA: \"%s\" redirected to \"%s\"", _context->url, location);
 
-  /* Verify the crc */
-  if(_context->header.header.crc32 != _context->calculatedCrc32) {
-    DEBUG_ERROR("%s: CRC32 mismatch", __FUNCTION__);
-    return Error::OtaHeaderCrc;
-  }
+      // the connection is kept only if the redirect stays on the same server
+      // and the body of the redirect response can be consumed
+      bool reuse = _context->http.skipBody(*_client, ARDUINO_ESP32_OTA_HTTP_HEADER_RECEIVE_TIMEOUT_ms);
+      bool same_origin;
 
-  clean();
+      if(!_context->redirect(location, &same_origin)) {
+        DEBUG_VERBOSE("OTA ERROR: cannot allocate the redirect location \"%s\"", location);
+        err = Error::UrlParseError;
+        goto exit;
+      }
 
-  return Error::None;
-}
+      if(!same_origin) {
+        releaseClient();
+      } else if(!reuse) {
+        _client->stop();
+      }
 
-Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::update()
-{
-  Arduino_ESP32_OTA::Error res = Error::None;
-  if(_context != nullptr && (res = verify()) != Error::None) {
-    return res;
-  }
+      continue;
+    }
 
-  if (!Update.end(true)) {
-    DEBUG_ERROR("%s: Failure to apply OTA update", __FUNCTION__);
-    return Error::OtaStorageEnd;
+    if(statusCode != 200) {
+      DEBUG_VERBOSE("OTA ERROR: get response on \"%s\" returned status %d", _context->url, statusCode);
+      err = Error::HttpResponse;
+      goto exit;
+    }
+
+    break;
   }
 
-  return res;
+exit:
+  _context->http.setLocationBuffer(nullptr, 0);
+  free(location);
+
+  return err;
+}
+
+int Arduino_ESP32_OTA::downloadPoll()
+{
+  int http_res =  static_cast<int>(Error::None);;
+  int res = 0;
+  size_t allowed = SIZE_MAX;
+  uint32_t const start = micros();
+  uint32_t budget = _poll_budget_bytes;
+  uint32_t elapsed;
+
+  // when bufferedBytes > 0 the processing resumes from the bytes left by the previous call,
+  // the inflated bytes held back by the time budget are written before reading more
+  if(_context->bufferedBytes == 0 && !decodersPending()) {
+    // body bytes are read straight into the decoder input buffer
+    if(_stream != nullptr) {
+      // local sources are read in large blocks, never past the end of the image and
+      // never more than available, readBytes() would wait for the missing bytes
+      size_t len = _context->contentLength - _context->downloadedSize;
+      int available = _stream->available();
+
+      if(available > 0 && (size_t)available < len) {
+        len = available;
+      }
+      if(len > _context->block_len) {
+        len = _context->block_len;
+      }
+
+      http_res = (len > 0 && available > 0) ? _stream->readBytes(_context->block, len) : 0;
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+    } else if(_link_busy || (allowed = _rate_limit.available(micros())) == 0) {
+#else
+    } else if(_link_busy) {
+#endif
+      // the application holds the link, the server is not late
+      _context->lastReceived = millis();
+      goto exit;
+    } else if(_client->available() == 0) {
+      http_res = 0;
+    } else {
+      http_res = _client->read(_context->block, allowed < _context->block_len ? allowed : _context->block_len);
+
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+      if(http_res > 0) {
+        _rate_limit.consume(http_res);
+      }
+#endif
+    }
+
+    if(http_res < 0) {
+      DEBUG_VERBOSE("OTA ERROR: Download read error %d", http_res);
+      res = static_cast<int>(Error::OtaDownload);
+      goto exit;
+    }
+
+    if(http_res == 0) {
+      // a source that stops sending, e.g. a truncated file or a dropped connection
+      if(millis() - _context->lastReceived > ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms) {
+        DEBUG_VERBOSE("OTA ERROR: no data received for %u ms", (unsigned int)ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms);
+        _context->downloadState = OtaDownloadError;
+        res = static_cast<int>(Error::OtaDownload);
+      }
+      goto exit;
+    }
+
+    _context->lastReceived = millis();
+    _context->downloadedSize += http_res;
+    _context->bufferOffset = 0;
+    _context->bufferedBytes = http_res;
+  }
+
+  while(_context->bufferedBytes > 0 || decodersPending()) {
+    if(decodersPending()) {
+      // the decoders get no more input until the inflated bytes held back are written
+      res = drainDecoders();
+    } else {
+      // the buffer is processed in slices, so that the time budget can be checked
+      // in between and the work stops at a byte boundary the decoder can resume from
+      uint32_t slice = _context->bufferedBytes;
+      if(budget != 0 && slice > budget) {
+        slice = budget;
+      }
+      if(_poll_budget_us != 0 && slice > ARDUINO_ESP32_OTA_POLL_SLICE) {
+        slice = ARDUINO_ESP32_OTA_POLL_SLICE;
+      }
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+      // a slice does not cross the end of a block, the bytes inflated from it are written
+      // before the next block resets the decoders
+      if(_poll_budget_us != 0 && _context->blocks != nullptr && _context->blocks->remaining() != 0 &&
+          slice > _context->blocks->remaining()) {
+        slice = _context->blocks->remaining();
+      }
+#endif
+
+      uint8_t* cursor = _context->block + _context->bufferOffset;
+      uint8_t* const end = cursor + slice;
+
+      _context->bufferOffset += slice;
+      _context->bufferedBytes -= slice;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+      if(_context->content_inflater != nullptr) {
+        res = decodeContent(cursor, slice);
+      } else {
+        res = processPayload(cursor, end);
+      }
+#else
+      res = processPayload(cursor, end);
+#endif
+
+      if(res == 0 && budget != 0 && (budget -= slice) == 0) {
+        break;
+      }
+    }
+
+    if(res != 0) {
+      goto exit;
+    }
+
+    if(_poll_budget_us != 0 && micros() - start >= _poll_budget_us) {
+      break;
+    }
+  }
+
+  if(_context->bufferedBytes > 0 || decodersPending()) {
+    goto exit;
+  }
+
+  if(_context->downloadState == OtaDownloadHeader && _context->downloadedSize >= _context->contentLength) {
+    DEBUG_ERROR("%s: the image is shorter than the ota header", __FUNCTION__);
+    _context->downloadState = OtaDownloadError;
+    res = static_cast<int>(Error::OtaHeaderLength);
+  }
+
+  if(_context->downloadState == OtaDownloadFile) {
+    // TODO there should be no more bytes available when the download is completed
+    if(_context->downloadedSize == _context->contentLength) {
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+      if(_context->blocks != nullptr && !_context->blocks->done()) {
+        DEBUG_ERROR("%s: payload ended before its last block", __FUNCTION__);
+        _context->downloadState = OtaDownloadError;
+        res = static_cast<int>(Error::OtaBlockCrc);
+      } else
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+      if(_context->erased_runs != nullptr && !_context->erased_runs->done()) {
+        DEBUG_ERROR("%s: payload ended inside an erased run record", __FUNCTION__);
+        _context->downloadState = OtaDownloadError;
+        res = static_cast<int>(Error::OtaCompression);
+      } else
+#endif
+      {
+        _context->downloadState = OtaDownloadCompleted;
+        res = 1;
+      }
+    }
+
+    if(_context->downloadedSize > _context->contentLength) {
+      _context->downloadState = OtaDownloadError;
+      res = static_cast<int>(Error::OtaDownload);
+    }
+  }
+
+exit:
+  elapsed = micros() - start;
+  if(elapsed > _poll_max_us) {
+    _poll_max_us = elapsed;
+  }
+
+  sampleHeap();
+
+  if(res < 0 && _context->partial) {
+    DEBUG_ERROR("%s: bundle failed with error %d after a data partition has been written", __FUNCTION__, res);
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+    _partition_writer.abort();
+#endif
+    _context->downloadState = OtaDownloadError;
+    res = static_cast<int>(Error::OtaPartialUpdate);
+  }
+
+  if(_context->downloadState == OtaDownloadError ||
+      _context->downloadState == OtaDownloadMagicNumberMismatch) {
+    clean(); // need to clean everything because the download failed
+  } else if(_context->downloadState == OtaDownloadCompleted) {
+    // only need to delete the client and not the context, since it will be needed
+    releaseClient();
+    _stream = nullptr;
+  }
+
+  return res;
+}
+
+int Arduino_ESP32_OTA::processPayload(uint8_t * cursor, uint8_t * const end)
+{
+  int res = 0;
+
+  while(cursor < end) {
+    switch(_context->downloadState) {
+    case OtaDownloadHeader: {
+      uint32_t copied = sizeof(_context->header.buf) - _context->headerCopiedBytes;
+      if((uint32_t)(end - cursor) < copied) {
+        copied = end - cursor;
+      }
+      memcpy(_context->header.buf+_context->headerCopiedBytes, cursor, copied);
+      cursor += copied;
+      _context->headerCopiedBytes += copied;
+
+      // when finished go to next state
+      if(sizeof(_context->header.buf) == _context->headerCopiedBytes) {
+        _context->downloadState = OtaDownloadFile;
+
+        _context->calculatedCrc32 = crc_update(
+          _context->calculatedCrc32,
+          &(_context->header.header.magic_number),
+          sizeof(_context->header) - offsetof(OtaHeader, header.magic_number)
+        );
+
+        if(_context->header.header.magic_number != _magic) {
+          _context->downloadState = OtaDownloadMagicNumberMismatch;
+          res = static_cast<int>(Error::OtaHeaderMagicNumber);
+
+          goto exit;
+        }
+
+        if(_context->checkExpectedCrc32 && _context->header.header.crc32 != _context->expectedCrc32) {
+          DEBUG_ERROR("%s: image crc does not match the manifest", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaManifest);
+
+          goto exit;
+        }
+
+        // an image listed with codec none is neither deflated nor built against a window
+        if(_context->raw && (_context->header.header.hdr_version.field.spare & (PayloadFlagDeflate | PayloadFlagPrimedWindow))) {
+          DEBUG_ERROR("%s: image is compressed but the manifest lists it with codec none", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaManifest);
+
+          goto exit;
+        }
+
+        switch(_context->header.header.hdr_version.field.header_version) {
+        case PayloadContainerStream:
+          break;
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+        case PayloadContainerBlocks:
+          _context->blocks = new BlockContainerDecoder(
+            [this](uint32_t block){
+              return startBlock(block);
+            },
+            [this](uint8_t* buffer, uint32_t size){
+              return decodePayload(buffer, size);
+            });
+          break;
+#if !defined(ARDUINO_ESP32_OTA_NO_BUNDLE)
+        case PayloadContainerBundle:
+          // the sections are packed on their own, only the encryption applies to the whole payload
+          if(_context->header.header.hdr_version.field.spare & ~PayloadFlagEncrypted) {
+            DEBUG_ERROR("%s: bundle flags are set on its sections", __FUNCTION__);
+            _context->downloadState = OtaDownloadError;
+            res = static_cast<int>(Error::OtaBundle);
+
+            goto exit;
+          }
+
+          _context->blocks = new BlockContainerDecoder(
+            [this](uint32_t section){
+              return startSection(section);
+            },
+            [this](uint8_t* buffer, uint32_t size){
+              return decodePayload(buffer, size);
+            }, true);
+          break;
+#endif /* ARDUINO_ESP32_OTA_NO_BUNDLE */
+#endif /* ARDUINO_ESP32_OTA_NO_BLOCKS */
+        default:
+          DEBUG_ERROR("%s: unsupported header version %d", __FUNCTION__, _context->header.header.hdr_version.field.header_version);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaHeaderVersion);
+
+          goto exit;
+        }
+
+        // the tag is only checked once the whole payload has been written, by then a data
+        // partition has been overwritten in place while the app partition is not activated yet
+        if((_context->header.header.hdr_version.field.spare & PayloadFlagEncrypted) &&
+            _context->header.header.hdr_version.field.header_version != PayloadContainerBundle &&
+            _context->header.header.hdr_version.field.payload_target != PayloadTargetApp) {
+          DEBUG_ERROR("%s: encrypted payloads can only target the app partition", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaPayloadTarget);
+
+          goto exit;
+        }
+
+        // the window is primed with the running firmware, only an app image is built against it,
+        // as checkBundle() requires for the sections of a bundle
+        if((_context->header.header.hdr_version.field.spare & PayloadFlagPrimedWindow) &&
+            _context->header.header.hdr_version.field.header_version != PayloadContainerBundle &&
+            _context->header.header.hdr_version.field.payload_target != PayloadTargetApp) {
+          DEBUG_ERROR("%s: only app payloads can have a primed window", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaDictionary);
+
+          goto exit;
+        }
+
+        // the sections of a bundle select their own target
+        Error err = Error::None;
+        if(_context->header.header.hdr_version.field.header_version != PayloadContainerBundle) {
+          err = selectPayloadTarget(_context->header.header.hdr_version.field.payload_target);
+        }
+        if(err != Error::None) {
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(err);
+
+          goto exit;
+        }
+
+        if(_context->header.header.hdr_version.field.spare & PayloadFlagEncrypted) {
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+          // the header fields following the crc are authenticated with the payload,
+          // len counts them together with the payload
+          uint32_t ad_len = sizeof(_context->header) - offsetof(OtaHeader, header.magic_number);
+          _context->decryptor = new AESCTRDecryptor(_decryption_key, _decryption_key_size,
+            _context->header.buf + offsetof(OtaHeader, header.magic_number), ad_len,
+            _context->header.header.len > ad_len ? _context->header.header.len - ad_len : 0);
+
+          if(!_context->decryptor->valid()) {
+            DEBUG_ERROR("%s: payload is encrypted but no valid key is configured or it is too short", __FUNCTION__);
+            _context->downloadState = OtaDownloadError;
+            res = static_cast<int>(Error::OtaDecryptionKey);
+
+            goto exit;
+          }
+#else
+          DEBUG_ERROR("%s: encrypted payloads are disabled", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaDecryptionKey);
+
+          goto exit;
+#endif
+        }
+
+        if(_context->header.header.hdr_version.field.spare & PayloadFlagErasedRuns) {
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+          _context->erased_runs = newErasedRunDecoder();
+#else
+          DEBUG_ERROR("%s: erased runs payloads are disabled", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaCompression);
+
+          goto exit;
+#endif
+        }
+
+        if(_context->header.header.hdr_version.field.spare & PayloadFlagDeflate) {
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+          // the inflate window cannot be primed, such a payload cannot be decoded
+          if(_context->header.header.hdr_version.field.spare & PayloadFlagPrimedWindow) {
+            DEBUG_ERROR("%s: deflate payloads do not support a primed window", __FUNCTION__);
+            _context->downloadState = OtaDownloadError;
+            res = static_cast<int>(Error::OtaDictionary);
+
+            goto exit;
+          }
+
+          _context->inflater = newInflater();
+#else
+          DEBUG_ERROR("%s: deflate payloads are disabled", __FUNCTION__);
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(Error::OtaCompression);
+
+          goto exit;
+#endif
+        }
+
+        // blocks are primed when they are started
+        if((_context->header.header.hdr_version.field.spare & PayloadFlagPrimedWindow) &&
+            _context->header.header.hdr_version.field.header_version == PayloadContainerStream) {
+          err = primeDecoder();
+          if(err != Error::None) {
+            _context->downloadState = OtaDownloadError;
+            res = static_cast<int>(err);
+
+            goto exit;
+          }
+        }
+      }
+
+      break;
+    }
+    case OtaDownloadFile: {
+      uint32_t len = end - cursor;
+      uint8_t * data = cursor;
+      size_t data_len = len;
+
+      // the crc is computed on the payload as it has been transferred
+      _context->calculatedCrc32 = crc_update(
+          _context->calculatedCrc32,
+          cursor,
+          len
+        );
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+      if(_context->decryptor != nullptr) {
+        data += _context->decryptor->decrypt(cursor, len, &data_len);
+      }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+      if(_context->blocks != nullptr) {
+        if(_context->blocks->decode(data, data_len) == BlockContainerDecoder::CORRUPTED) {
+          DEBUG_ERROR("%s: block %d of %d is corrupted", __FUNCTION__,
+            _context->blocks->currentBlock(), _context->blocks->blockCount());
+          _context->downloadState = OtaDownloadError;
+          res = static_cast<int>(_context->error != Error::None ? _context->error :
+            _context->decodeFailed ? Error::OtaCompression : Error::OtaBlockCrc);
+
+          goto exit;
+        }
+      } else
+#endif
+      if(!decodePayload(data, data_len)) {
+        _context->downloadState = OtaDownloadError;
+        res = static_cast<int>(Error::OtaCompression);
+
+        goto exit;
+      }
+
+      if(storageFailed()) {
+        DEBUG_ERROR("%s: failed to write the image to flash", __FUNCTION__);
+        _context->downloadState = OtaDownloadError;
+        res = static_cast<int>(Error::OtaStorageWrite);
+
+        goto exit;
+      }
+
+      cursor += len;
+      break;
+    }
+    case OtaDownloadCompleted:
+      res = 1;
+      goto exit;
+    default:
+      _context->downloadState = OtaDownloadError;
+      res = static_cast<int>(Error::OtaDownload);
+      goto exit;
+    }
+  }
+
+exit:
+  return res;
+}
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+int Arduino_ESP32_OTA::decodeContent(uint8_t * buffer, uint32_t size)
+{
+  /* the decoded bytes are passed to processPayload() by the content_inflater callback */
+  _context->content_inflater->setOutputLimit(_poll_budget_us != 0 ? ARDUINO_ESP32_OTA_POLL_INFLATE_SLICE : 0);
+
+  if(_context->content_inflater->decompress(buffer, size) != InflateDecoder::CORRUPTED) {
+    return 0;
+  }
+
+  if(_context->error == Error::None) {
+    DEBUG_ERROR("%s: invalid gzip content", __FUNCTION__);
+    _context->downloadState = OtaDownloadError;
+    _context->error = Error::OtaDownload;
+  }
+
+  return static_cast<int>(_context->error);
+}
+#endif
+
+bool Arduino_ESP32_OTA::decodersPending()
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  return (_context->content_inflater != nullptr && _context->content_inflater->pending()) ||
+    (_context->inflater != nullptr && _context->inflater->pending());
+#else
+  return false;
+#endif
+}
+
+int Arduino_ESP32_OTA::drainDecoders()
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  /* the content is inflated first, its output may leave more bytes in the payload inflater */
+  if(_context->content_inflater != nullptr && _context->content_inflater->pending()) {
+    return decodeContent(nullptr, 0);
+  }
+
+  if(!decodePayload(nullptr, 0)) {
+    _context->downloadState = OtaDownloadError;
+    return static_cast<int>(Error::OtaCompression);
+  }
+
+  if(storageFailed()) {
+    DEBUG_ERROR("%s: failed to write the payload", __FUNCTION__);
+    _context->downloadState = OtaDownloadError;
+    return static_cast<int>(Error::OtaStorageWrite);
+  }
+#endif
+
+  return 0;
+}
+
+void Arduino_ESP32_OTA::setPollBudget(uint32_t max_bytes, uint32_t max_us)
+{
+  _poll_budget_bytes = max_bytes;
+  _poll_budget_us = max_us;
+}
+
+uint32_t Arduino_ESP32_OTA::downloadPollMaxTime()
+{
+  return _poll_max_us;
+}
+
+size_t Arduino_ESP32_OTA::downloadPeakMemory()
+{
+  return _heap_before_download - _heap_min_free;
+}
+
+uint32_t Arduino_ESP32_OTA::downloadSkippedSectors()
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  return _partition_writer.skippedSectors();
+#else
+  return 0;
+#endif
+}
+
+uint32_t Arduino_ESP32_OTA::downloadErasedBytes()
+{
+  return _erased_bytes;
+}
+
+void Arduino_ESP32_OTA::sampleHeap()
+{
+  uint32_t free_heap = ESP.getFreeHeap();
+  if(free_heap < _heap_min_free) {
+    _heap_min_free = free_heap;
+  }
+}
+
+int Arduino_ESP32_OTA::downloadProgress()
+{
+  if(_context->error != Error::None) {
+    return static_cast<int>(_context->error);
+  } else {
+    return _context->downloadedSize;
+  }
+}
+
+size_t Arduino_ESP32_OTA::downloadSize()
+{
+  return (_client != nullptr || _stream != nullptr) ? _context->contentLength : 0;
+}
+
+int Arduino_ESP32_OTA::download(const char * ota_url)
+{
+  int err = startDownload(ota_url);
+
+  if(err < 0) {
+    return err;
+  }
+
+  int res = 0;
+  while((res = downloadPoll()) == 0);
+
+  return res == 1? _context->writtenBytes : res;
+}
+
+int Arduino_ESP32_OTA::download(Stream & stream, size_t size)
+{
+  int err = startDownload(stream, size);
+
+  if(err < 0) {
+    return err;
+  }
+
+  int res = 0;
+  while((res = downloadPoll()) == 0);
+
+  return res == 1? _context->writtenBytes : res;
+}
+
+void Arduino_ESP32_OTA::newContext(const char * url)
+{
+  _context = new Context(url, [this](uint8_t data){
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+    if(_context->erased_runs != nullptr) {
+      _context->erased_runs->decode(data);
+      return;
+    }
+#endif
+    _context->writtenBytes++;
+    write_byte_to_flash(data);
+  });
+}
+
+void Arduino_ESP32_OTA::clean()
+{
+  releaseClient();
+  _stream = nullptr;
+
+  if(_context != nullptr) {
+    delete _context;
+    _context = nullptr;
+  }
+}
+
+Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::verify()
+{
+  assert(_context != nullptr);
+
+  /* ... then finalize ... */
+  _context->calculatedCrc32 ^= 0xFFFFFFFF;
+
+  /* Verify the crc */
+  if(_context->header.header.crc32 != _context->calculatedCrc32) {
+    DEBUG_ERROR("%s: CRC32 mismatch", __FUNCTION__);
+    if(_context->partial) {
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+      /* the data partition keeps its first bytes erased */
+      _partition_writer.abort();
+#endif
+      return Error::OtaPartialUpdate;
+    }
+    return Error::OtaHeaderCrc;
+  }
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+  /* The crc does not protect from changes, the image is committed only if its tag matches */
+  if(_context->decryptor != nullptr && !_context->decryptor->authentic()) {
+    DEBUG_ERROR("%s: the encrypted payload failed authentication", __FUNCTION__);
+    return Error::OtaAuthentication;
+  }
+#endif
+
+  clean();
+
+  return Error::None;
+}
+
+Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::update()
+{
+  Arduino_ESP32_OTA::Error res = Error::None;
+  if(_context != nullptr && (res = verify()) != Error::None) {
+    return res;
+  }
+
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  bool ended = _flash_writer == FlashWriterPartition ? _partition_writer.end() : Update.end(true);
+#else
+  bool ended = Update.end(true);
+#endif
+
+  if (!ended) {
+    DEBUG_ERROR("%s: Failure to apply OTA update", __FUNCTION__);
+    return Error::OtaStorageEnd;
+  }
+
+  return res;
 }
 
 void Arduino_ESP32_OTA::reset()
@@ -367,6 +1219,425 @@ void Arduino_ESP32_OTA::reset()
   ESP.restart();
 }
 
+bool Arduino_ESP32_OTA::storageFailed()
+{
+  /* a write past the end of the partition or a flash failure, the remaining bytes are dropped */
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  if(_flash_writer == FlashWriterPartition) {
+    return _partition_writer.hasError();
+  }
+#endif
+  return Update.hasError();
+}
+
+Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::selectPayloadTarget(uint8_t target)
+{
+  /* Update has been started on the app partition by begin() */
+  if(target == _context->target) {
+    return Error::None;
+  }
+
+  switch(target) {
+  case PayloadTargetApp:
+    /* the app section of a bundle follows the data partitions, which have been closed */
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+    if(_flash_writer == FlashWriterPartition) {
+      if(!_partition_writer.begin(esp_ota_get_next_update_partition(NULL), _flash_buffer)) {
+        DEBUG_ERROR("%s: failed to initialize flash partition writer", __FUNCTION__);
+        return Error::OtaStorageInit;
+      }
+      break;
+    }
+#endif
+
+    if(Update.isRunning()) {
+      Update.abort();
+    }
+
+    if(!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+      DEBUG_ERROR("%s: failed to initialize flash update", __FUNCTION__);
+      return Error::OtaStorageInit;
+    }
+    break;
+  case PayloadTargetFilesystem:
+    /* Nothing has been written yet, restart the update on the data partition */
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+    if(_flash_writer == FlashWriterPartition) {
+      /* the same partition and offset the Update library uses for U_SPIFFS */
+      const esp_partition_t * data = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+      size_t offset = 0;
+      if(data == nullptr) {
+        /* FFat images do not include the first sector of the FAT partition */
+        data = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+        offset = ARDUINO_ESP32_OTA_FFAT_OFFSET;
+      }
+
+      if(!_partition_writer.begin(data, _flash_buffer, offset)) {
+        DEBUG_ERROR("%s: failed to initialize filesystem update", __FUNCTION__);
+        return Error::OtaStorageInit;
+      }
+      break;
+    }
+#endif
+
+    if(Update.isRunning()) {
+      Update.abort();
+    }
+
+    if(!Update.begin(UPDATE_SIZE_UNKNOWN, U_SPIFFS)) {
+      DEBUG_ERROR("%s: failed to initialize filesystem update", __FUNCTION__);
+      return Error::OtaStorageInit;
+    }
+    break;
+  default:
+    DEBUG_ERROR("%s: unsupported payload target %d", __FUNCTION__, target);
+    return Error::OtaPayloadTarget;
+  }
+
+  _context->target = target;
+  return Error::None;
+}
+
+Arduino_ESP32_OTA::Error Arduino_ESP32_OTA::primeDecoder()
+{
+  /* The encoder seeded its window with the beginning of the firmware the
+   * image has been built against, which is the one currently running
+   */
+  const esp_partition_t * running = esp_ota_get_running_partition();
+
+  if(running == nullptr) {
+    DEBUG_ERROR("%s: unable to find the running partition", __FUNCTION__);
+    return Error::OtaDictionary;
+  }
+
+#if defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  DEBUG_ERROR("%s: LZSS decoder is disabled", __FUNCTION__);
+  return Error::OtaDictionary;
+#else
+  /* the dictionary is read in small chunks, the payload buffer still holds unprocessed bytes */
+  uint8_t chunk[64];
+
+  for(uint32_t offset = 0; offset < LZSSDecoder::DICTIONARY_SIZE; ) {
+    uint32_t len = LZSSDecoder::DICTIONARY_SIZE - offset < sizeof(chunk) ?
+      LZSSDecoder::DICTIONARY_SIZE - offset : sizeof(chunk);
+
+    if(esp_partition_read(running, offset, chunk, len) != ESP_OK) {
+      DEBUG_ERROR("%s: failed to read the running partition", __FUNCTION__);
+      return Error::OtaDictionary;
+    }
+
+    offset += _context->decoder.prime(chunk, len);
+  }
+
+  return Error::None;
+#endif
+}
+
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+bool Arduino_ESP32_OTA::startBlock(uint32_t block)
+{
+  /* every block is decoded from the initial state, as it has been encoded */
+  (void)block;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  _context->decoder.reset();
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if(_context->inflater != nullptr) {
+    // the bytes held back by the time budget belong to the previous block
+    _context->inflater->setOutputLimit(0);
+    if(_context->inflater->decompress(nullptr, 0) == InflateDecoder::CORRUPTED) {
+      _context->decodeFailed = true;
+      return false;
+    }
+    _context->inflater->reset();
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  if(_context->erased_runs != nullptr) {
+    // a record cannot span two blocks
+    if(!_context->erased_runs->done()) {
+      _context->decodeFailed = true;
+      return false;
+    }
+    _context->erased_runs->reset();
+  }
+#endif
+
+  if(_context->header.header.hdr_version.field.spare & PayloadFlagPrimedWindow) {
+    return primeDecoder() == Error::None;
+  }
+
+  return true;
+}
+#endif /* ARDUINO_ESP32_OTA_NO_BLOCKS */
+
+#if !defined(ARDUINO_ESP32_OTA_NO_BUNDLE)
+bool Arduino_ESP32_OTA::startSection(uint32_t section)
+{
+  uint32_t tag = _context->blocks->tag(section);
+  uint8_t target = tag & 0xFF;
+  uint8_t flags = (tag >> 8) & 0xFF;
+  Error err;
+
+  /* the whole index is checked before the first byte is written */
+  if(section == 0 && !checkBundle()) {
+    _context->error = Error::OtaBundle;
+    return false;
+  }
+
+  /* the decoders deliver the last bytes of the previous section */
+  if(!startBlock(section)) {
+    return false;
+  }
+
+  /* the app partition is the last section, it is committed by update() after the image
+   * crc is verified. The partition writer holds the first bytes of a data partition back
+   * until then, the Update library has to finalize it before it can start the next one
+   */
+  if(section > 0) {
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+    bool closed = _flash_writer == FlashWriterPartition ? _partition_writer.close() : Update.end(true);
+#else
+    bool closed = Update.end(true);
+#endif
+
+    if(!closed) {
+      DEBUG_ERROR("%s: failed to write section %d", __FUNCTION__, (int)section - 1);
+      _context->error = Error::OtaStorageEnd;
+      return false;
+    }
+  }
+
+  if((err = selectPayloadTarget(target)) != Error::None) {
+    _context->error = err;
+    return false;
+  }
+
+  if(target != PayloadTargetApp) {
+    _context->partial = true;
+  }
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if((flags & PayloadFlagDeflate) && _context->inflater == nullptr) {
+    _context->inflater = newInflater();
+  } else if(!(flags & PayloadFlagDeflate) && _context->inflater != nullptr) {
+    delete _context->inflater;
+    _context->inflater = nullptr;
+  }
+#else
+  if(flags & PayloadFlagDeflate) {
+    DEBUG_ERROR("%s: deflate payloads are disabled", __FUNCTION__);
+    _context->error = Error::OtaCompression;
+    return false;
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  if((flags & PayloadFlagErasedRuns) && _context->erased_runs == nullptr) {
+    _context->erased_runs = newErasedRunDecoder();
+  } else if(!(flags & PayloadFlagErasedRuns) && _context->erased_runs != nullptr) {
+    delete _context->erased_runs;
+    _context->erased_runs = nullptr;
+  }
+#endif
+
+  if(flags & PayloadFlagPrimedWindow) {
+    if((err = primeDecoder()) != Error::None) {
+      _context->error = err;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Arduino_ESP32_OTA::checkBundle()
+{
+  uint8_t targets = 0;
+  uint8_t supported = PayloadFlagPrimedWindow;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  supported |= PayloadFlagErasedRuns;
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  supported |= PayloadFlagDeflate;
+#endif
+
+  for(uint32_t i = 0; i < _context->blocks->blockCount(); i++) {
+    uint32_t tag = _context->blocks->tag(i);
+    uint8_t target = tag & 0xFF;
+    uint8_t flags = (tag >> 8) & 0xFF;
+
+    /* an empty section would leave its partition without content, a flag left out of
+     * the build would only be found once the previous sections have been written */
+    if((tag >> 16) != 0 || _context->blocks->length(i) == 0 || (flags & ~supported)) {
+      DEBUG_ERROR("%s: section %d is malformed", __FUNCTION__, (int)i);
+      return false;
+    }
+
+    if(target > PayloadTargetFilesystem || (targets & (1 << target))) {
+      DEBUG_ERROR("%s: section %d has an unsupported or repeated target %d", __FUNCTION__, (int)i, target);
+      return false;
+    }
+    targets |= 1 << target;
+
+    /* the tag of an encrypted bundle is checked after the data partitions have been written */
+    if(target != PayloadTargetApp && (_context->header.header.hdr_version.field.spare & PayloadFlagEncrypted)) {
+      DEBUG_ERROR("%s: section %d of an encrypted bundle does not target the app", __FUNCTION__, (int)i);
+      return false;
+    }
+
+    /* the app partition is written last, so that it is not activated when a data section fails */
+    if(target == PayloadTargetApp && i + 1 != _context->blocks->blockCount()) {
+      DEBUG_ERROR("%s: the app section is not the last one", __FUNCTION__);
+      return false;
+    }
+
+    /* the window is primed with the running firmware, LZSS only */
+    if((flags & PayloadFlagPrimedWindow) && (target != PayloadTargetApp || (flags & PayloadFlagDeflate))) {
+      DEBUG_ERROR("%s: section %d cannot have a primed window", __FUNCTION__, (int)i);
+      return false;
+    }
+  }
+
+  return true;
+}
+#endif /* ARDUINO_ESP32_OTA_NO_BUNDLE */
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+InflateDecoder * Arduino_ESP32_OTA::newInflater()
+{
+  return new InflateDecoder([this](const uint8_t* data, uint32_t len){
+    for(uint32_t i = 0; i < len; i++) {
+      _context->putc(data[i]);
+    }
+    return true;
+  });
+}
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+ErasedRunDecoder * Arduino_ESP32_OTA::newErasedRunDecoder()
+{
+  return new ErasedRunDecoder(
+    [this](uint8_t data){
+      _context->writtenBytes++;
+      write_byte_to_flash(data);
+    },
+    [this](uint32_t len){
+      _context->writtenBytes += len;
+      _erased_bytes += len;
+      write_erased_to_flash(len);
+    });
+}
+#endif
+
+bool Arduino_ESP32_OTA::decodePayload(uint8_t * buffer, uint32_t size)
+{
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if(_context->inflater != nullptr) {
+    _context->inflater->setOutputLimit(_poll_budget_us != 0 ? ARDUINO_ESP32_OTA_POLL_INFLATE_SLICE : 0);
+
+    // invalid deflate data, or the window could not be allocated
+    if(_context->inflater->decompress(buffer, size) == InflateDecoder::CORRUPTED) {
+      DEBUG_ERROR("%s: failed to inflate the payload", __FUNCTION__);
+      _context->decodeFailed = true;
+      return false;
+    }
+    return true;
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  if(!_context->raw) {
+    // any bit sequence is valid LZSS, a corrupted payload is detected by the crc
+    _context->decoder.decompress(buffer, size);
+    return true;
+  }
+#endif
+
+  for(uint32_t i = 0; i < size; i++) {
+    _context->putc(buffer[i]);
+  }
+  return true;
+}
+
+Client * Arduino_ESP32_OTA::newClient(const char * schema)
+{
+  Client * client = nullptr;
+
+  if(_user_client != nullptr) {
+    /* the caller chose the transport, the scheme only selects the default port */
+    client = _user_client;
+  } else if(strcmp(schema, "http") == 0) {
+    client = new WiFiClient();
+  }
+#if !defined(ARDUINO_ESP32_OTA_NO_TLS)
+  else if(strcmp(schema, "https") == 0) {
+    client = new WiFiClientSecure();
+    if (_ca_cert != nullptr) {
+      static_cast<WiFiClientSecure*>(client)->setCACert(_ca_cert);
+    }
+#if (ESP_ARDUINO_VERSION < ESP_ARDUINO_VERSION_VAL(3, 0, 4))
+    else if (_ca_cert_bundle != nullptr) {
+      static_cast<WiFiClientSecure*>(client)->setCACertBundle(_ca_cert_bundle);
+    }
+#else
+    else if (_ca_cert_bundle != nullptr && _ca_cert_bundle_size != 0) {
+      static_cast<WiFiClientSecure*>(client)->setCACertBundle(_ca_cert_bundle, _ca_cert_bundle_size);
+    }
+#endif
+    else {
+      DEBUG_VERBOSE("%s: CA not configured for download client", __FUNCTION__);
+    }
+  }
+#endif
+
+  return client;
+}
+
+void Arduino_ESP32_OTA::releaseClient()
+{
+  if(_client == nullptr) {
+    return;
+  }
+
+  if(_client == _user_client) {
+    _client->stop();
+  } else {
+    delete _client;
+  }
+  _client = nullptr;
+}
+
+void Arduino_ESP32_OTA::cacheRedirect(const char * from, const char * to)
+{
+  clearRedirectCache();
+
+  _redirect_from = (char*)malloc(strlen(from)+1);
+  _redirect_to = (char*)malloc(strlen(to)+1);
+
+  if(_redirect_from == nullptr || _redirect_to == nullptr) {
+    clearRedirectCache();
+    return;
+  }
+
+  strcpy(_redirect_from, from);
+  strcpy(_redirect_to, to);
+}
+
+void Arduino_ESP32_OTA::clearRedirectCache()
+{
+  free(_redirect_from);
+  _redirect_from = nullptr;
+
+  free(_redirect_to);
+  _redirect_to = nullptr;
+}
+
 bool Arduino_ESP32_OTA::isCapable()
 {
   const esp_partition_t * ota_0  = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
@@ -380,19 +1651,154 @@ bool Arduino_ESP32_OTA::isCapable()
 
 Arduino_ESP32_OTA::Context::Context(
   const char* url, std::function<void(uint8_t)> putc)
-    : url((char*)malloc(strlen(url)+1))
-    , parsed_url(url)
+    : url(url != nullptr ? (char*)malloc(strlen(url)+1) : nullptr)
+    , parsed_url(url != nullptr ? new ParsedUrl(url) : nullptr)
     , downloadState(OtaDownloadHeader)
     , calculatedCrc32(0xFFFFFFFF)
     , headerCopiedBytes(0)
     , downloadedSize(0)
     , writtenBytes(0)
+    , checkExpectedCrc32(false)
+    , expectedCrc32(0)
+    , raw(false)
     , error(Error::None)
-    , decoder(putc) {
-      strcpy(this->url, url);
+    , decodeFailed(false)
+    , target(PayloadTargetApp)
+    , partial(false)
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
+    , decoder(putc)
+#endif
+    , putc(putc)
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+    , inflater(nullptr)
+    , content_inflater(nullptr)
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+    , blocks(nullptr)
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+    , erased_runs(nullptr)
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+    , decryptor(nullptr)
+#endif
+    , http(buffer, sizeof(buffer))
+    , contentLength(0)
+    , lastReceived(0)
+    , bufferOffset(0)
+    , bufferedBytes(0)
+    , block(buffer)
+    , block_len(sizeof(buffer)) {
+      if(this->url != nullptr) {
+        strcpy(this->url, url);
+      }
     }
 
 Arduino_ESP32_OTA::Context::~Context(){
   free(url);
   url = nullptr;
-}
\ No newline at end of file
+
+  if(block != buffer) {
+    free(block);
+  }
+  block = nullptr;
+
+  delete parsed_url;
+  parsed_url = nullptr;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  if(inflater != nullptr) {
+    delete inflater;
+    inflater = nullptr;
+  }
+
+  if(content_inflater != nullptr) {
+    delete content_inflater;
+    content_inflater = nullptr;
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+  if(blocks != nullptr) {
+    delete blocks;
+    blocks = nullptr;
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  if(erased_runs != nullptr) {
+    delete erased_runs;
+    erased_runs = nullptr;
+  }
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+  if(decryptor != nullptr) {
+    delete decryptor;
+    decryptor = nullptr;
+  }
+#endif
+}
+bool Arduino_ESP32_OTA::Context::redirect(const char* location, bool* same_origin) {
+  // the fragment is not sent to the server
+  size_t location_len = strcspn(location, "#");
+  size_t scheme_len = strcspn(location, ":/?#");
+  const char* path = parsed_url->path();
+  const char* last_slash = strrchr(path, '/');
+  size_t dir_len = last_slash != nullptr ? last_slash + 1 - path : 0;
+  size_t base_len;
+  size_t len;
+  char* next;
+
+  if(strncmp(location + scheme_len, "://", 3) == 0 && scheme_len > 0) {
+    // absolute url
+    base_len = 0;
+  } else if(location[0] == '/' && location[1] == '/') {
+    // network path reference, the scheme is the current one
+    base_len = strlen(parsed_url->schema()) + 1;
+  } else if(location[0] == '/') {
+    // absolute path on the same server
+    base_len = strlen(parsed_url->schema()) + strlen(parsed_url->host()) + 9;
+  } else if(location[0] == '?') {
+    // query of the current path
+    base_len = strlen(parsed_url->schema()) + strlen(parsed_url->host()) + 9 + strlen(path);
+  } else {
+    // relative path, it replaces the last segment of the current path
+    base_len = strlen(parsed_url->schema()) + strlen(parsed_url->host()) + 9 + dir_len;
+  }
+
+  len = base_len + location_len + 1;
+  if((next = (char*)malloc(len)) == nullptr) {
+    return false;
+  }
+
+  if(base_len == 0) {
+    next[0] = '\0';
+  } else if(location[0] == '/' && location[1] == '/') {
+    snprintf(next, len, "%s:", parsed_url->schema());
+  } else {
+    snprintf(next, len, "%s://%s:%u", parsed_url->schema(), parsed_url->host(), parsed_url->port());
+
+    if(location[0] == '?') {
+      strcat(next, path);
+    } else if(location[0] != '/') {
+      strncat(next, path, dir_len);
+    }
+  }
+  strncat(next, location, location_len);
+
+  ParsedUrl* next_parsed = new ParsedUrl(next);
+
+  *same_origin =
+    strcmp(next_parsed->schema(), parsed_url->schema()) == 0 &&
+    strcmp(next_parsed->host(), parsed_url->host()) == 0 &&
+    next_parsed->port() == parsed_url->port();
+
+  free(url);
+  delete parsed_url;
+
+  url = next;
+  parsed_url = next_parsed;
+
+  return true;
+}
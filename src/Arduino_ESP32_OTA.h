@@ -23,17 +23,63 @@
  ******************************************************************************/
 
 #include <Arduino_DebugUtils.h>
-#include <WiFiClientSecure.h>
+#if !defined(ARDUINO_ESP32_OTA_NO_TLS)
+  #include <WiFiClientSecure.h>
+#endif
 #include <WiFi.h>
 #include "decompress/utility.h"
-#include "decompress/lzss.h"
-#include <ArduinoHttpClient.h>
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  #include "decompress/erased_runs.h"
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+  #include "decompress/block_container.h"
+#endif
+#include "decompress/inflate.h"
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
+  #include "decompress/lzss.h"
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+  #include "decrypt/aes_ctr.h"
+#endif
+#include "http/http_client.h"
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+  #include "utility/token_bucket.h"
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  #include "flash/partition_writer.h"
+#endif
+#include "manifest/manifest_parser.h"
 #include <URLParser.h>
 #include <stdint.h>
 
 /******************************************************************************
    DEFINES
  ******************************************************************************/
+
+/* The following options can be defined with the compiler flags, e.g. by adding
+ * -DARDUINO_ESP32_OTA_NO_TLS to build_flags, to leave unused features out of the binary
+ *
+ * ARDUINO_ESP32_OTA_NO_TLS              only http urls are accepted, WiFiClientSecure is not linked
+ * ARDUINO_ESP32_OTA_NO_LZSS             the payload is not compressed and it is written as it is received
+ * ARDUINO_ESP32_OTA_NO_ENCRYPTION       encrypted payloads are rejected, AES is not linked
+ * ARDUINO_ESP32_OTA_NO_DEFLATE          zlib and gzip payloads are rejected, it is defined when the ROM
+ *                                       of the target does not provide the inflate functions
+ * ARDUINO_ESP32_OTA_NO_BLOCKS           block containers are rejected with OtaHeaderVersion, it implies
+ *                                       ARDUINO_ESP32_OTA_NO_BUNDLE
+ * ARDUINO_ESP32_OTA_NO_BUNDLE           bundles are rejected with OtaHeaderVersion
+ * ARDUINO_ESP32_OTA_NO_ERASED_RUNS      payloads with erased runs are rejected with OtaCompression
+ * ARDUINO_ESP32_OTA_NO_PARTITION_WRITER begin() fails with FlashWriterPartition, only the Update
+ *                                       library writes to flash
+ * ARDUINO_ESP32_OTA_NO_RATE_LIMIT       setRateLimit() has no effect
+ * ARDUINO_ESP32_OTA_NO_MANIFEST         startManifestDownload() returns OtaManifest
+ *
+ * The http client, the ota header and crc checks and the Update library writer are always built
+ */
+
+#if defined(ARDUINO_ESP32_OTA_NO_BLOCKS) && !defined(ARDUINO_ESP32_OTA_NO_BUNDLE)
+  #define ARDUINO_ESP32_OTA_NO_BUNDLE
+#endif
+
 #if defined (ARDUINO_NANO_ESP32)
   #define ARDUINO_ESP32_OTA_MAGIC 0x23410070
 #else
@@ -46,6 +92,12 @@
 static uint32_t const ARDUINO_ESP32_OTA_HTTP_HEADER_RECEIVE_TIMEOUT_ms = 10000;
 static uint32_t const ARDUINO_ESP32_OTA_BINARY_HEADER_RECEIVE_TIMEOUT_ms = 10000;
 static uint32_t const ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms = 2000;
+static uint32_t const ARDUINO_ESP32_OTA_POLL_SLICE = 8;
+static uint32_t const ARDUINO_ESP32_OTA_POLL_INFLATE_SLICE = 512;
+static uint8_t  const ARDUINO_ESP32_OTA_MAX_REDIRECTS = 5;
+static size_t   const ARDUINO_ESP32_OTA_MAX_LOCATION_LENGTH = 1536;
+static size_t   const ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE = 4096;
+static size_t   const ARDUINO_ESP32_OTA_FFAT_OFFSET = 0x1000;
 
 /******************************************************************************
  * CLASS DECLARATION
@@ -71,7 +123,21 @@ public:
     OtaHeaderMagicNumber = -11,
     OtaDownload          = -12,
     OtaHeaderTimeout     = -13,
-    HttpResponse         = -14
+    HttpResponse         = -14,
+    OtaPayloadTarget     = -15,
+    OtaDecryptionKey     = -16,
+    OtaDictionary        = -17,
+    OtaHeaderVersion     = -18,
+    OtaBlockCrc          = -19,
+    OtaCompression       = -20,
+    OtaManifest          = -21,
+    OtaNoUpdate          = -22,
+    OtaStorageWrite      = -23,
+    OtaRunningVersion    = -24,
+    OtaBundle            = -25,
+    OtaAuthentication    = -26,
+    // a bundle failed after a data section has been started, see PayloadContainerBundle
+    OtaPartialUpdate     = -27
   };
 
   enum OTADownloadState: uint8_t {
@@ -82,30 +148,157 @@ public:
     OtaDownloadError
   };
 
+  // values of the payload_target field of the ota header, they select the
+  // partition the payload is written to
+  enum PayloadTarget: uint8_t {
+    PayloadTargetApp        = 0,
+    PayloadTargetFilesystem = 1
+  };
+
+  // values of the header_version field of the ota header, they select how the payload is laid out
+  // PayloadContainerStream: a single compressed stream
+  // PayloadContainerBlocks: an index of blocks compressed on their own, each with its crc,
+  //                         see BlockContainerDecoder
+  // PayloadContainerBundle: a tagged block container with a section for each partition,
+  //                         the tag of a section holds its PayloadTarget in bits 0-7 and
+  //                         its PayloadFlags in bits 8-15. The data partitions come first,
+  //                         the app partition, if any, is the last section. A data partition
+  //                         is rewritten in place: once its section has started, a failure,
+  //                         including an image crc mismatch in update(), is reported as
+  //                         OtaPartialUpdate and the partition content is lost. With
+  //                         FlashWriterPartition its first bytes are only programmed by
+  //                         update() after the image crc has been verified, so it is never
+  //                         left looking valid; with FlashWriterUpdate it is finalized as
+  //                         soon as its section is complete
+  enum PayloadContainer: uint8_t {
+    PayloadContainerStream = 0,
+    PayloadContainerBlocks = 1,
+    PayloadContainerBundle = 2
+  };
+
+  // how the image is written to flash
+  // FlashWriterUpdate: through the Update library of the core
+  // FlashWriterPartition: straight to the partition, sector by sector, with
+  //                       esp_partition_erase_range and esp_partition_write
+  enum FlashWriter: uint8_t {
+    FlashWriterUpdate,
+    FlashWriterPartition
+  };
+
+  // bits of the spare field of the ota header, they describe how the payload
+  // has been packed
+  enum PayloadFlags: uint8_t {
+    PayloadFlagEncrypted    = 0x01,
+    PayloadFlagPrimedWindow = 0x02,
+    PayloadFlagErasedRuns   = 0x04,
+    PayloadFlagDeflate      = 0x08
+  };
+
            Arduino_ESP32_OTA();
   virtual ~Arduino_ESP32_OTA();
 
   Arduino_ESP32_OTA::Error begin(uint32_t magic = ARDUINO_ESP32_OTA_MAGIC);
+  // select how the image is written to flash, it must be called before begin()
+  // buffer: optional OtaPartitionWriter::SECTOR_SIZE bytes DMA capable buffer used by FlashWriterPartition,
+  //         begin() fails with OtaStorageInit if it is not word aligned or not DMA capable
+  void setFlashWriter(FlashWriter writer, uint8_t * buffer = nullptr);
   void setMagic(uint32_t magic);
+  // version of the running firmware, used to select the image from a manifest,
+  // it must be set before startManifestDownload()
+  void setRunningVersion(uint8_t major, uint8_t minor, uint8_t patch);
   void setCACert(const char *rootCA);
   void setCACertBundle(const uint8_t * bundle) __attribute__((deprecated));
   void setCACertBundle (const uint8_t * bundle, size_t size);
 
+  // use client for the downloads instead of creating a WiFiClient or a WiFiClientSecure
+  // from the url scheme, e.g. an EthernetClient or a TLS client running over a modem.
+  // The client is not owned by the library, it is stopped when a download ends and
+  // any TLS configuration has to be applied by the caller. nullptr restores the default
+  void setClient(Client * client);
+
+  // request gzip compressed responses with Accept-Encoding, e.g. from a server compressing
+  // on the fly. Responses with Content-Encoding: gzip are decompressed in any case, the
+  // request asks for identity unless enabled. It has no effect with ARDUINO_ESP32_OTA_NO_DEFLATE
+  void setAcceptGzip(bool accept);
+
+  // set the AES key used to decrypt payloads flagged as encrypted in the ota header,
+  // the key is not copied and must stay valid until the download is completed.
+  // The HMAC-SHA256 key that authenticates the payload is derived from it. The payload is
+  // authenticated once it has been written, so encrypted payloads can only target the app
+  void setDecryptionKey(const uint8_t * key, size_t size);
+
+  // limit the bandwidth used by the download, so that it can run together with
+  // the application traffic. It can be changed while a download is in progress
+  // bytes_per_second: 0 removes the limit
+  // burst: maximum number of bytes read at once after an idle period, 0 means one second worth of bytes
+  void setRateLimit(uint32_t bytes_per_second, uint32_t burst = 0);
+
+  // signal that the application needs the link: while busy downloadPoll()
+  // does not read from the network
+  void setLinkBusy(bool busy);
+
   // blocking version for the download
   // returns the size of the downloaded binary
   int download(const char * ota_url);
+  int download(Stream & stream, size_t size);
 
   // start a download in a non blocking fashion
   // call downloadPoll, until it returns OtaDownloadCompleted
   // returns the value in content-length http header
+  // up to ARDUINO_ESP32_OTA_MAX_REDIRECTS redirects are followed, the final location
+  // is remembered and used directly when the same url is requested again
   int startDownload(const char * ota_url);
 
+  // download the manifest at manifest_url, see OtaManifestParser for its format, and
+  // start the download of the image selected for this board and running version.
+  // The manifest is parsed while it is received, before any payload is transferred;
+  // the size and the crc32 of the image are then checked against the manifest as soon
+  // as the response and the ota header are received.
+  // The manifest request follows redirects as startDownload() does.
+  // returns the value in content-length http header of the image, OtaNoUpdate if the
+  // manifest has no newer image for this board, OtaRunningVersion if setRunningVersion()
+  // has not been called
+  int startManifestDownload(const char * manifest_url);
+
+  // start an update from a local source, e.g. a File on an SD card or a Serial port,
+  // providing the content of the .ota file. The stream is not owned by the library and
+  // it is read in blocks of ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE bytes by downloadPoll,
+  // without rate limit. The update then proceeds as a download from a url
+  // size: size of the .ota file
+  // returns size
+  int startDownload(Stream & stream, size_t size);
+
   // This function is used to make the download progress.
   // it returns 0, if the download is in progress
   // it returns 1, if the download is completed
   // it returns <0 if an error occurred, following Error enum values
   virtual int downloadPoll();
 
+  // limit the work done by a single downloadPoll() call, the next call resumes
+  // from the byte where the previous one stopped. 0 disables the limit
+  // max_bytes: maximum number of downloaded bytes processed by a call
+  // max_us: processing stops as soon as this time is exceeded, it is checked
+  //         every ARDUINO_ESP32_OTA_POLL_SLICE bytes and every
+  //         ARDUINO_ESP32_OTA_POLL_INFLATE_SLICE inflated bytes
+  void setPollBudget(uint32_t max_bytes, uint32_t max_us = 0);
+
+  // the longest time in microseconds spent in a downloadPoll() call since the
+  // download has been started
+  uint32_t downloadPollMaxTime();
+
+  // heap used by the download since it has been started, including the TLS session
+  // buffers. It returns the difference between the free heap before connecting to the
+  // server and the lowest free heap observed while downloading
+  size_t downloadPeakMemory();
+
+  // number of flash sectors that already had the right content and have not been
+  // erased and programmed, only FlashWriterPartition compares sectors before writing
+  uint32_t downloadSkippedSectors();
+
+  // number of erased (0xFF) bytes of the image that have not been transferred,
+  // they are sent as run lengths when the payload is flagged with PayloadFlagErasedRuns
+  uint32_t downloadErasedBytes();
+
   // this function is used to get the progress of the download
   // it returns a positive value when the download is progressing correctly
   // it returns a negative value on error following Error enum values
@@ -116,6 +309,8 @@ public:
   size_t downloadSize();
 
   virtual void write_byte_to_flash(uint8_t data);
+  // advance the image by len erased (0xFF) bytes, FlashWriterPartition does not program them
+  virtual void write_erased_to_flash(uint32_t len);
   Arduino_ESP32_OTA::Error verify();
   Arduino_ESP32_OTA::Error update();
   void reset();
@@ -129,8 +324,13 @@ protected:
 
     ~Context();
 
+    // replace the url with the location the server redirected to, resolved against
+    // the current url. same_origin is set if the new location is on the same server,
+    // it returns false if the memory cannot be allocated
+    bool redirect(const char* location, bool* same_origin);
+
     char*             url;
-    ParsedUrl         parsed_url;
+    ParsedUrl*        parsed_url;
     OtaHeader         header;
     OTADownloadState  downloadState;
     uint32_t          calculatedCrc32;
@@ -138,11 +338,73 @@ protected:
     uint32_t          downloadedSize;
     uint32_t          writtenBytes;
 
+    // crc32 the manifest lists for the image, checked against the ota header
+    bool              checkExpectedCrc32;
+    uint32_t          expectedCrc32;
+
+    // the payload is stored as it is, the manifest lists the image with codec none
+    bool              raw;
+
     // If an error occurred during download it is reported in this field
     Error             error;
 
+    // the payload decoder failed, e.g. on invalid deflate data
+    bool              decodeFailed;
+
+    // PayloadTarget of the partition being written
+    uint8_t           target;
+
+    // a data section of a bundle has been started, its partition cannot be restored
+    bool              partial;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_LZSS)
     // LZSS decoder
     LZSSDecoder       decoder;
+#endif
+    std::function<void(uint8_t)> putc;
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+    // inflate decoder for payloads flagged with PayloadFlagDeflate, it replaces the LZSS decoder
+    InflateDecoder*   inflater;
+
+    // inflate decoder for responses with Content-Encoding: gzip, it is applied to the
+    // whole body before the ota header is parsed
+    InflateDecoder*   content_inflater;
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+    // block container decoder, allocated only for PayloadContainerBlocks payloads
+    BlockContainerDecoder* blocks;
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+    // erased runs decoder, allocated only for payloads flagged with PayloadFlagErasedRuns
+    ErasedRunDecoder* erased_runs;
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_ENCRYPTION)
+    // AES-CTR decryptor and HMAC-SHA256 verifier, allocated only for encrypted payloads
+    AESCTRDecryptor*  decryptor;
+#endif
+
+    // HTTP response, its headers are received in buffer
+    OtaHttpClient     http;
+
+    // size of the .ota file, from the content-length http header or given with the stream
+    uint32_t          contentLength;
+
+    // millis() when the last bytes have been received, the download fails after
+    // ARDUINO_ESP32_OTA_BINARY_BYTE_RECEIVE_TIMEOUT_ms without data
+    uint32_t          lastReceived;
+
+    // bytes received in block that still need to be processed, starting at bufferOffset
+    size_t            bufferOffset;
+    size_t            bufferedBytes;
+
+    // the payload is read into block: buffer for downloads, a larger
+    // ARDUINO_ESP32_OTA_STREAM_BLOCK_SIZE bytes buffer for local sources
+    uint8_t*          block;
+    size_t            block_len;
 
     const size_t buf_len = 64;
     uint8_t buffer[64];
@@ -150,13 +412,70 @@ protected:
 
 private:
   Client * _client;
-  HttpClient* _http_client;
+  Stream * _stream;
+  Client * _user_client;
   const char * _ca_cert;
   const uint8_t * _ca_cert_bundle;
   size_t _ca_cert_bundle_size;
+#if !defined(ARDUINO_ESP32_OTA_NO_RATE_LIMIT)
+  TokenBucket _rate_limit;
+#endif
+  bool _link_busy;
+  bool _accept_gzip;
+  uint32_t _poll_budget_bytes;
+  uint32_t _poll_budget_us;
+  uint32_t _poll_max_us;
+  uint32_t _heap_before_download;
+  uint32_t _heap_min_free;
+  uint32_t _erased_bytes;
+  char * _redirect_from;
+  char * _redirect_to;
+  FlashWriter _flash_writer;
+  uint8_t * _flash_buffer;
+#if !defined(ARDUINO_ESP32_OTA_NO_PARTITION_WRITER)
+  OtaPartitionWriter _partition_writer;
+#endif
+  const uint8_t * _decryption_key;
+  size_t _decryption_key_size;
   uint32_t _magic;
+  uint32_t _running_version;
+  bool _running_version_set;
+  uint32_t _manifest_size;
+  uint32_t _manifest_crc32;
+  uint8_t _manifest_codec;
 
   void clean();
+  void newContext(const char * url);
+  void sampleHeap();
+  int requestDownload(const char * url);
+  Arduino_ESP32_OTA::Error requestUrl();
+  Client * newClient(const char * schema);
+  void releaseClient();
+  void cacheRedirect(const char * from, const char * to);
+  void clearRedirectCache();
+  bool storageFailed();
+  Arduino_ESP32_OTA::Error selectPayloadTarget(uint8_t target);
+  Arduino_ESP32_OTA::Error primeDecoder();
+#if !defined(ARDUINO_ESP32_OTA_NO_BLOCKS)
+  bool startBlock(uint32_t block);
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_BUNDLE)
+  bool startSection(uint32_t section);
+  bool checkBundle();
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  InflateDecoder * newInflater();
+#endif
+#if !defined(ARDUINO_ESP32_OTA_NO_ERASED_RUNS)
+  ErasedRunDecoder * newErasedRunDecoder();
+#endif
+  bool decodePayload(uint8_t * buffer, uint32_t size);
+  int processPayload(uint8_t * cursor, uint8_t * const end);
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  int decodeContent(uint8_t * buffer, uint32_t size);
+#endif
+  bool decodersPending();
+  int drainDecoders();
 };
 
 #endif /* ARDUINO_ESP32_OTA_H_ */
@@ -0,0 +1,141 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "block_container.h"
+#include "utility.h"
+
+#include <stdlib.h>
+
+/**************************************************************************************
+   FUNCTION DEFINITION
+ **************************************************************************************/
+
+static inline uint32_t le32(const uint8_t* b) {
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/**************************************************************************************
+   BLOCK CONTAINER DECODER CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+BlockContainerDecoder::BlockContainerDecoder(std::function<bool(uint32_t)> block_start_cbk, std::function<bool(uint8_t*, uint32_t)> block_data_cbk, bool tagged)
+: _state(FSM_COUNT), _index(nullptr), _tagged(tagged), _count(0), _block(0), _remaining(0), _crc(0), _field_len(0)
+, _block_start_cbk(block_start_cbk), _block_data_cbk(block_data_cbk) {
+}
+
+BlockContainerDecoder::~BlockContainerDecoder() {
+    free(_index);
+}
+
+BlockContainerDecoder::status BlockContainerDecoder::decode(uint8_t* buffer, uint32_t size) {
+    while(size > 0 && _state != FSM_ERROR) {
+        switch(_state) {
+        case FSM_COUNT:
+            _field[_field_len++] = *buffer++;
+            size--;
+
+            if(_field_len == sizeof(uint32_t)) {
+                _count = le32(_field);
+                _field_len = 0;
+
+                if(_count == 0) {
+                    _state = FSM_DONE;
+                } else if(_count > MAX_BLOCKS || (_index = (Block*)malloc(_count * sizeof(Block))) == nullptr) {
+                    _state = FSM_ERROR;
+                } else {
+                    _state = FSM_INDEX;
+                }
+            }
+            break;
+        case FSM_INDEX:
+            _field[_field_len++] = *buffer++;
+            size--;
+
+            if(_field_len == (_tagged ? 3 : 2) * sizeof(uint32_t)) {
+                const uint8_t* field = _field;
+
+                _index[_block].tag = _tagged ? le32(field) : 0;
+                field += _tagged ? sizeof(uint32_t) : 0;
+                _index[_block].length = le32(field);
+                _index[_block].crc32 = le32(field + sizeof(uint32_t));
+                _field_len = 0;
+
+                if(++_block == _count) {
+                    startBlock(0);
+                    endBlocks();
+                }
+            }
+            break;
+        case FSM_BLOCK: {
+            uint32_t len = size < _remaining ? size : _remaining;
+
+            _crc = crc_update(_crc, buffer, len);
+            if(!_block_data_cbk(buffer, len)) {
+                _state = FSM_ERROR;
+                break;
+            }
+
+            buffer += len;
+            size -= len;
+            _remaining -= len;
+
+            endBlocks();
+            break;
+        }
+        case FSM_NEXT_BLOCK:
+            startBlock(_block + 1);
+            endBlocks();
+            break;
+        case FSM_DONE:
+            // the payload is longer than the blocks listed in the index
+            _state = FSM_ERROR;
+            break;
+        case FSM_ERROR:
+            break;
+        }
+    }
+
+    return _state == FSM_DONE ? DONE : _state == FSM_ERROR ? CORRUPTED : IN_PROGRESS;
+}
+
+void BlockContainerDecoder::startBlock(uint32_t block) {
+    _block = block;
+    _remaining = _index[block].length;
+    _crc = 0xFFFFFFFF;
+    _state = _block_start_cbk(block) ? FSM_BLOCK : FSM_ERROR;
+}
+
+void BlockContainerDecoder::endBlocks() {
+    // a completed block is verified before moving to the next one, which is started by
+    // its first byte: the decoders may still hold output of the completed block.
+    // Empty blocks are completed as soon as they are started
+    while(_state == FSM_BLOCK && _remaining == 0) {
+        if((_crc ^ 0xFFFFFFFF) != _index[_block].crc32) {
+            _state = FSM_ERROR;
+        } else if(_block + 1 == _count) {
+            _state = FSM_DONE;
+        } else if(_index[_block + 1].length != 0) {
+            _state = FSM_NEXT_BLOCK;
+        } else {
+            startBlock(_block + 1);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <functional>
+#include <stdint.h>
+
+/**************************************************************************************
+   BLOCK CONTAINER DECODER CLASS
+ **************************************************************************************/
+
+/**
+ * Split a block container payload into its blocks. All the fields are 32 bit little endian:
+ *
+ *   | block count | length 0 | crc32 0 | ... | length n-1 | crc32 n-1 | block 0 | ... | block n-1 |
+ *
+ * Every block is compressed on its own; the start callback is invoked with the first
+ * byte of each block, so that the decoders can be reset, and the crc of a block is
+ * verified as soon as its last byte is received.
+ *
+ * A tagged container has a 32 bit tag before the length of each block, it describes
+ * the block to the start callback:
+ *
+ *   | block count | tag 0 | length 0 | crc32 0 | ... | block 0 | ... | block n-1 |
+ */
+class BlockContainerDecoder {
+public:
+
+    enum status: uint8_t {
+        IN_PROGRESS,
+        DONE,
+        CORRUPTED
+    };
+
+    static const uint32_t MAX_BLOCKS = 1024;
+
+    /**
+     * @param block_start_cbk: called with the index of the block about to be decoded,
+     *                         returning false stops the decoding with an error
+     * @param block_data_cbk: called with the bytes of the current block, returning
+     *                        false stops the decoding with an error
+     * @param tagged: the index has a tag for each block
+     */
+    BlockContainerDecoder(std::function<bool(uint32_t)> block_start_cbk, std::function<bool(uint8_t*, uint32_t)> block_data_cbk, bool tagged = false);
+    ~BlockContainerDecoder();
+
+    /**
+     * decode the provided buffer, bytes following the last block are an error
+     * @return CORRUPTED on a malformed index, on a block crc mismatch or when a callback fails
+     */
+    status decode(uint8_t* buffer, uint32_t size);
+
+    inline bool done() const            { return _state == FSM_DONE; }
+    inline uint32_t blockCount() const  { return _count; }
+
+    // the block being decoded, or the corrupted one after an error
+    inline uint32_t currentBlock() const { return _block; }
+
+    // bytes missing to the end of the current block, 0 outside of a block
+    inline uint32_t remaining() const   { return _state == FSM_BLOCK ? _remaining : 0; }
+
+    // the index is complete when the first block is started
+    inline uint32_t tag(uint32_t block) const    { return _index[block].tag; }
+    inline uint32_t length(uint32_t block) const { return _index[block].length; }
+
+private:
+    enum FSM_STATES: uint8_t {
+        FSM_COUNT,
+        FSM_INDEX,
+        FSM_BLOCK,
+        FSM_NEXT_BLOCK,
+        FSM_DONE,
+        FSM_ERROR
+    } _state;
+
+    struct Block {
+        uint32_t tag;
+        uint32_t length;
+        uint32_t crc32;
+    } *_index;
+
+    bool _tagged;
+    uint32_t _count;
+    uint32_t _block;
+    uint32_t _remaining;
+    uint32_t _crc;
+
+    uint8_t _field[3 * sizeof(uint32_t)];
+    uint8_t _field_len;
+
+    std::function<bool(uint32_t)> _block_start_cbk;
+    std::function<bool(uint8_t*, uint32_t)> _block_data_cbk;
+
+    void startBlock(uint32_t block);
+    void endBlocks();
+};
@@ -0,0 +1,74 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "erased_runs.h"
+
+/**************************************************************************************
+   ERASED RUN DECODER CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+ErasedRunDecoder::ErasedRunDecoder(std::function<void(const uint8_t)> putc_cbk, std::function<void(uint32_t)> skip_cbk)
+: state(FSM_LITERAL_LENGTH), value(0), value_bytes(0), put_char_cbk(putc_cbk), skip_cbk(skip_cbk) {
+}
+
+void ErasedRunDecoder::decode(const uint8_t c) {
+    switch(state) {
+    case FSM_LITERAL:
+        put_char_cbk(c);
+
+        if(--value == 0) {
+            state = FSM_ERASED_LENGTH;
+        }
+        break;
+    case FSM_LITERAL_LENGTH:
+    case FSM_ERASED_LENGTH:
+        value |= (uint32_t)c << (8 * value_bytes++);
+
+        if(value_bytes < sizeof(value)) {
+            break;
+        }
+
+        if(state == FSM_LITERAL_LENGTH) {
+            state = value != 0 ? FSM_LITERAL : FSM_ERASED_LENGTH;
+
+            // keep the literal length as a down counter
+            if(state == FSM_LITERAL) {
+                value_bytes = 0;
+                break;
+            }
+        } else {
+            if(value != 0) {
+                skip_cbk(value);
+            }
+            state = FSM_LITERAL_LENGTH;
+        }
+
+        value = 0;
+        value_bytes = 0;
+        break;
+    }
+}
+
+void ErasedRunDecoder::reset() {
+    state = FSM_LITERAL_LENGTH;
+    value = 0;
+    value_bytes = 0;
+}
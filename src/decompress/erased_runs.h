@@ -0,0 +1,65 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <functional>
+#include <stdint.h>
+
+/**************************************************************************************
+   ERASED RUN DECODER CLASS
+ **************************************************************************************/
+
+/**
+ * Decode an image where runs of erased flash (0xFF) have been replaced by skip tokens.
+ * The stream is a sequence of records, all the lengths are 32 bit little endian:
+ *
+ *   | literal length | literal bytes ... | erased length |
+ *
+ * literal bytes are forwarded to the put callback, erased length is forwarded to
+ * the skip callback so that the destination can be advanced without programming.
+ */
+class ErasedRunDecoder {
+public:
+
+    ErasedRunDecoder(std::function<void(const uint8_t)> putc_cbk, std::function<void(uint32_t)> skip_cbk);
+
+    void decode(const uint8_t c);
+
+    // start decoding a new sequence of records
+    void reset();
+
+    // true when the bytes decoded so far end on a record boundary
+    inline bool done() const { return state == FSM_LITERAL_LENGTH && value_bytes == 0; }
+
+private:
+    enum FSM_STATES: uint8_t {
+        FSM_LITERAL_LENGTH,
+        FSM_LITERAL,
+        FSM_ERASED_LENGTH
+    } state;
+
+    uint32_t value;
+    uint8_t value_bytes;
+
+    std::function<void(const uint8_t)> put_char_cbk;
+    std::function<void(uint32_t)> skip_cbk;
+};
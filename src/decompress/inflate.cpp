@@ -0,0 +1,291 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "inflate.h"
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************
+   CONSTANTS
+ **************************************************************************************/
+
+static const uint8_t GZIP_ID1 = 0x1F;
+static const uint8_t GZIP_ID2 = 0x8B;
+static const uint8_t GZIP_HEADER_SIZE = 10;
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+
+static const uint8_t ZLIB_CM_DEFLATE = 8;
+static const uint8_t ZLIB_CINFO_MAX = 7;
+
+/**************************************************************************************
+   INFLATE DECODER CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+InflateDecoder::InflateDecoder(std::function<bool(const uint8_t*, uint32_t)> output_cbk)
+: _state(FSM_FORMAT), _inflator(nullptr), _window(nullptr), _window_size(0), _window_offset(0)
+, _flags(0), _has_more_output(false), _pending_offset(0), _pending_len(0), _output_limit(0), _delivered(0)
+, _carry_len(0), _gzip_flags(0), _extra_len(0), _skip(0), _output_cbk(output_cbk) {
+}
+
+InflateDecoder::~InflateDecoder() {
+    reset();
+}
+
+InflateDecoder::status InflateDecoder::decompress(const uint8_t* buffer, uint32_t size) {
+    _delivered = 0;
+
+    // the input left over by the previous call goes first
+    if(_carry_len > 0) {
+        const uint8_t* carry = _carry;
+        uint32_t carry_len = _carry_len;
+
+        run(carry, carry_len);
+        memmove(_carry, carry, carry_len);
+        _carry_len = carry_len;
+    }
+
+    if(_carry_len == 0) {
+        run(buffer, size);
+    }
+
+    if(size > 0 && _state != FSM_ERROR) {
+        if(_carry_len + size <= CARRY_SIZE) {
+            memcpy(_carry + _carry_len, buffer, size);
+            _carry_len += size;
+        } else {
+            // the input cannot be kept aside, the output limit is exceeded
+            uint32_t limit = _output_limit;
+            _output_limit = 0;
+
+            const uint8_t* carry = _carry;
+            uint32_t carry_len = _carry_len;
+            run(carry, carry_len);
+            _carry_len = 0;
+
+            run(buffer, size);
+            _output_limit = limit;
+        }
+    }
+
+    return _state == FSM_ERROR ? CORRUPTED : _state == FSM_DONE && _pending_len == 0 ? DONE : IN_PROGRESS;
+}
+
+void InflateDecoder::run(const uint8_t* &buffer, uint32_t &size) {
+    while(_state != FSM_ERROR && (_output_limit == 0 || _delivered < _output_limit)) {
+        // the decoded bytes are delivered before the window is used again
+        if(_pending_len > 0) {
+            deliver();
+            continue;
+        }
+
+        // the window may be full of decoded bytes that have not been delivered yet
+        if(size == 0 && !(_state == FSM_DATA && _has_more_output)) {
+            break;
+        }
+
+        switch(_state) {
+        case FSM_FORMAT:
+            if(buffer[0] == GZIP_ID1) {
+                _state = start(TINFL_LZ_DICT_SIZE, 0) ? FSM_GZIP_HEADER : FSM_ERROR;
+                _skip = GZIP_HEADER_SIZE;
+            } else if((buffer[0] & 0x0F) == ZLIB_CM_DEFLATE && (buffer[0] >> 4) <= ZLIB_CINFO_MAX) {
+                // CINFO is the base 2 logarithm of the window size minus 8, tinfl parses the
+                // rest of the zlib header
+                _state = start(1 << ((buffer[0] >> 4) + 8), TINFL_FLAG_PARSE_ZLIB_HEADER) ? FSM_DATA : FSM_ERROR;
+            } else {
+                _state = FSM_ERROR;
+            }
+            break;
+        case FSM_GZIP_HEADER:
+        case FSM_GZIP_EXTRA_LENGTH:
+        case FSM_GZIP_EXTRA:
+        case FSM_GZIP_NAME:
+        case FSM_GZIP_COMMENT:
+        case FSM_GZIP_HEADER_CRC:
+            gzipHeader(*buffer++);
+            size--;
+            break;
+        case FSM_DATA:
+            inflate(buffer, size);
+            break;
+        case FSM_DONE:
+            // gzip trailer or anything else following the stream
+            size = 0;
+            break;
+        case FSM_ERROR:
+            break;
+        }
+    }
+}
+
+void InflateDecoder::reset() {
+    free(_inflator);
+    free(_window);
+
+    _state = FSM_FORMAT;
+    _inflator = nullptr;
+    _window = nullptr;
+    _window_size = 0;
+    _window_offset = 0;
+    _flags = 0;
+    _has_more_output = false;
+    _pending_offset = 0;
+    _pending_len = 0;
+    _carry_len = 0;
+}
+
+bool InflateDecoder::start(size_t window_size, uint32_t flags) {
+    _inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    _window = (uint8_t*)malloc(window_size);
+
+    if(_inflator == nullptr || _window == nullptr) {
+        return false;
+    }
+
+    tinfl_init(_inflator);
+    _window_size = window_size;
+    _window_offset = 0;
+    _flags = flags | TINFL_FLAG_HAS_MORE_INPUT;
+
+    return true;
+}
+
+void InflateDecoder::gzipHeader(uint8_t c) {
+    switch(_state) {
+    case FSM_GZIP_HEADER:
+        // ID1, ID2, CM, FLG, MTIME, XFL, OS; _skip counts down the remaining bytes
+        if((_skip == GZIP_HEADER_SIZE - 1 && c != GZIP_ID2) ||
+           (_skip == GZIP_HEADER_SIZE - 2 && c != ZLIB_CM_DEFLATE)) {
+            _state = FSM_ERROR;
+            return;
+        } else if(_skip == GZIP_HEADER_SIZE - 3) {
+            _gzip_flags = c;
+        }
+
+        if(--_skip > 0) {
+            return;
+        }
+        break;
+    case FSM_GZIP_EXTRA_LENGTH:
+        // XLEN is little endian
+        _extra_len = (_extra_len >> 8) | ((uint16_t)c << 8);
+
+        if(--_skip > 0) {
+            return;
+        }
+
+        _gzip_flags &= ~GZIP_FEXTRA;
+        _skip = _extra_len;
+
+        if(_skip > 0) {
+            _state = FSM_GZIP_EXTRA;
+            return;
+        }
+        break;
+    case FSM_GZIP_EXTRA:
+        if(--_skip > 0) {
+            return;
+        }
+        break;
+    case FSM_GZIP_NAME:
+    case FSM_GZIP_COMMENT:
+        if(c != '\0') {
+            return;
+        }
+        _gzip_flags &= _state == FSM_GZIP_NAME ? ~GZIP_FNAME : ~GZIP_FCOMMENT;
+        break;
+    case FSM_GZIP_HEADER_CRC:
+        if(--_skip > 0) {
+            return;
+        }
+        _gzip_flags &= ~GZIP_FHCRC;
+        break;
+    default:
+        return;
+    }
+
+    // the optional fields follow the fixed header in this order
+    if(_gzip_flags & GZIP_FEXTRA) {
+        _state = FSM_GZIP_EXTRA_LENGTH;
+        _skip = 2;
+        _extra_len = 0;
+    } else if(_gzip_flags & GZIP_FNAME) {
+        _state = FSM_GZIP_NAME;
+    } else if(_gzip_flags & GZIP_FCOMMENT) {
+        _state = FSM_GZIP_COMMENT;
+    } else if(_gzip_flags & GZIP_FHCRC) {
+        _state = FSM_GZIP_HEADER_CRC;
+        _skip = 2;
+    } else {
+        _state = FSM_DATA;
+    }
+}
+
+void InflateDecoder::inflate(const uint8_t* &buffer, uint32_t &size) {
+    size_t in_len = size;
+    size_t out_len = _window_size - _window_offset;
+
+    // the window is used as a circular output buffer, tinfl wraps around it
+    tinfl_status res = tinfl_decompress(_inflator, buffer, &in_len,
+        _window, _window + _window_offset, &out_len, _flags);
+
+    buffer += in_len;
+    size -= in_len;
+
+    if(out_len > 0) {
+        _pending_offset = _window_offset;
+        _pending_len = out_len;
+        _window_offset = (_window_offset + out_len) & (_window_size - 1);
+    }
+
+    _has_more_output = res == TINFL_STATUS_HAS_MORE_OUTPUT;
+
+    if(res == TINFL_STATUS_DONE) {
+        _state = FSM_DONE;
+    } else if(res < 0) {
+        _state = FSM_ERROR;
+    }
+}
+
+void InflateDecoder::deliver() {
+    size_t len = _pending_len;
+
+    if(_output_limit != 0 && len > _output_limit - _delivered) {
+        len = _output_limit - _delivered;
+    }
+
+    if(!_output_cbk(_window + _pending_offset, len)) {
+        _state = FSM_ERROR;
+        return;
+    }
+
+    _pending_offset += len;
+    _pending_len -= len;
+    _delivered += len;
+}
+
+#endif /* ARDUINO_ESP32_OTA_NO_DEFLATE */
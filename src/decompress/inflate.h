@@ -0,0 +1,141 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+// the inflate implementation of miniz is part of the ROM of the ESP32 targets,
+// DEFLATE support is left out when the ROM does not provide it
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+  #if __has_include(<rom/miniz.h>)
+    #include <rom/miniz.h>
+  #else
+    #define ARDUINO_ESP32_OTA_NO_DEFLATE
+  #endif
+#endif
+
+#if !defined(ARDUINO_ESP32_OTA_NO_DEFLATE)
+
+/**************************************************************************************
+   INFLATE DECODER CLASS
+ **************************************************************************************/
+
+/**
+ * Streaming decoder for zlib (RFC 1950) and gzip (RFC 1952) streams, the format is
+ * detected from the first byte. The window is allocated when the stream starts: zlib
+ * streams declare the window size used by the encoder, gzip streams always need 32KB.
+ * The integrity of the data is left to the crc of the ota image, the adler32 and the
+ * gzip trailers are not verified.
+ */
+class InflateDecoder {
+public:
+
+    enum status: uint8_t {
+        IN_PROGRESS,
+        DONE,
+        CORRUPTED
+    };
+
+    /**
+     * @param output_cbk: called with the decoded bytes, the buffer is the decoder window
+     *                    and must not be modified. Returning false stops the decoding
+     */
+    InflateDecoder(std::function<bool(const uint8_t*, uint32_t)> output_cbk);
+    ~InflateDecoder();
+
+    static const size_t CARRY_SIZE = 128;
+
+    /**
+     * decode the provided buffer, the bytes following the end of the stream are ignored.
+     * When the output limit is reached the decoded bytes are kept in the window and up to
+     * CARRY_SIZE input bytes are kept aside, they are processed by the following calls;
+     * decompress(nullptr, 0) only delivers them
+     * @return CORRUPTED on invalid data, when the memory cannot be allocated or when the
+     *         output callback returns false
+     */
+    status decompress(const uint8_t* buffer, uint32_t size);
+
+    /**
+     * limit the bytes passed to the output callback by a decompress() call, 0 removes
+     * the limit. It is exceeded when more than CARRY_SIZE input bytes would be left over
+     */
+    inline void setOutputLimit(uint32_t limit) { _output_limit = limit; }
+
+    // decoded bytes or input bytes are left over by the output limit
+    inline bool pending() const {
+        return _pending_len > 0 || _carry_len > 0 || (_state == FSM_DATA && _has_more_output);
+    }
+
+    // release the memory and get ready for a new stream
+    void reset();
+
+    // memory allocated for the current stream
+    inline size_t memoryUsage() const { return _window_size + (_inflator != nullptr ? sizeof(tinfl_decompressor) : 0); }
+
+private:
+    enum FSM_STATES: uint8_t {
+        FSM_FORMAT,
+        FSM_GZIP_HEADER,
+        FSM_GZIP_EXTRA_LENGTH,
+        FSM_GZIP_EXTRA,
+        FSM_GZIP_NAME,
+        FSM_GZIP_COMMENT,
+        FSM_GZIP_HEADER_CRC,
+        FSM_DATA,
+        FSM_DONE,
+        FSM_ERROR
+    } _state;
+
+    tinfl_decompressor* _inflator;
+    uint8_t* _window;
+    size_t _window_size;
+    size_t _window_offset;
+    uint32_t _flags;
+    bool _has_more_output;
+
+    // decoded bytes in the window that have not been passed to the output callback
+    size_t _pending_offset;
+    size_t _pending_len;
+
+    uint32_t _output_limit;
+    uint32_t _delivered;
+
+    uint8_t _carry[CARRY_SIZE];
+    size_t _carry_len;
+
+    // gzip header parsing
+    uint8_t _gzip_flags;
+    uint16_t _extra_len;
+    uint32_t _skip;
+
+    std::function<bool(const uint8_t*, uint32_t)> _output_cbk;
+
+    void run(const uint8_t* &buffer, uint32_t &size);
+    bool start(size_t window_size, uint32_t flags);
+    void gzipHeader(uint8_t c);
+    void inflate(const uint8_t* &buffer, uint32_t &size);
+    void deliver();
+};
+
+#endif /* ARDUINO_ESP32_OTA_NO_DEFLATE */
@@ -16,6 +16,7 @@
 #include "lzss.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 /**************************************************************************************
    LZSS DECODER CLASS IMPLEMENTATION
@@ -120,6 +121,27 @@ LZSSDecoder::status LZSSDecoder::decompress(uint8_t* const buffer, uint32_t size
     return res;
 }
 
+uint32_t LZSSDecoder::prime(const uint8_t* const dict, uint32_t size) {
+    uint32_t len = DICTIONARY_SIZE - primed < size ? DICTIONARY_SIZE - primed : size;
+
+    // the encoder starts with r = N - F, the dictionary takes the place of the spaces before it
+    memcpy(buffer + primed, dict, len);
+    primed += len;
+
+    return len;
+}
+
+void LZSSDecoder::reset() {
+    for (int i = 0; i < N - F; i++) buffer[i] = ' ';
+    r = N - F;
+
+    state = FSM_0;
+    available = 0;
+    buf = 0;
+    buf_size = 0;
+    primed = 0;
+}
+
 int LZSSDecoder::getbit(uint8_t n) { // get n bits from buffer
     int x=0, c;
 
@@ -62,6 +62,20 @@ public:
      */
     status decompress(uint8_t* const buffer=nullptr, uint32_t size=0);
 
+    /**
+     * seed the initial window with a dictionary shared with the encoder, instead of spaces.
+     * Successive calls append to the bytes already provided, up to DICTIONARY_SIZE bytes;
+     * it must be called before the first call to decompress
+     * @return the number of bytes copied into the window
+     */
+    uint32_t prime(const uint8_t* const dict, uint32_t size);
+
+    /**
+     * drop the decoding state and restore the initial window, so that a new
+     * stream can be decoded; the window has to be primed again if needed
+     */
+    void reset();
+
     static const int LZSS_EOF = -1;
     static const int LZSS_BUFFER_EMPTY = -2;
 private:
@@ -70,9 +84,13 @@ private:
     static const int EJ =  4;             /* typically 4..5 */
     static const int N = (1 << EI);       /* buffer size */
     static const int F = ((1 << EJ) + 1); /* lookahead buffer size */
+public:
+    static const uint32_t DICTIONARY_SIZE = N - F;
+private:
 
-    // algorithm specific buffer used to store text that could be later referenced and copied
-    uint8_t buffer[N * 2];
+    // algorithm specific buffer used to store text that could be later referenced and copied,
+    // all the accesses are masked with N - 1
+    uint8_t buffer[N];
 
     // this function gets 1 single char from the input buffer
     int getc();
@@ -98,6 +116,9 @@ private:
     // there is no documentation about their meaning
     int i, r;
 
+    // number of window bytes already seeded by prime
+    uint32_t primed = 0;
+
     std::function<void(const uint8_t)> put_char_cbk;
     std::function<uint8_t()> get_char_cbk;
 
@@ -0,0 +1,108 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "aes_ctr.h"
+
+#include <string.h>
+
+/**************************************************************************************
+   AES-CTR DECRYPTOR CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+AESCTRDecryptor::AESCTRDecryptor(const uint8_t* key, size_t key_len, const uint8_t* ad, size_t ad_len, size_t payload_len)
+: _valid(false), _nc_off(0), _iv_copied(0), _position(0), _tag_offset(0), _tag_copied(0) {
+    const mbedtls_md_info_t* sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    uint8_t mac_key[TAG_SIZE];
+
+    mbedtls_aes_init(&_ctx);
+    mbedtls_md_init(&_mac);
+
+    // CTR mode uses the forward cipher for both directions. On ESP32 targets
+    // mbedTLS is backed by the AES and SHA peripherals. The md API is the same in
+    // mbedTLS 2.x and 3.x
+    if(key != nullptr && (key_len == 16 || key_len == 24 || key_len == 32) &&
+       payload_len >= IV_SIZE + TAG_SIZE) {
+        _valid = mbedtls_aes_setkey_enc(&_ctx, key, key_len * 8) == 0 &&
+            mbedtls_md_setup(&_mac, sha256, 1) == 0 &&
+            mbedtls_md_hmac(sha256, key, key_len, (const uint8_t*)MAC_KEY_LABEL, strlen(MAC_KEY_LABEL), mac_key) == 0 &&
+            mbedtls_md_hmac_starts(&_mac, mac_key, sizeof(mac_key)) == 0 &&
+            mbedtls_md_hmac_update(&_mac, ad, ad_len) == 0;
+        _tag_offset = payload_len - TAG_SIZE;
+    }
+
+    memset(mac_key, 0, sizeof(mac_key));
+    memset(_nonce_counter, 0, sizeof(_nonce_counter));
+    memset(_stream_block, 0, sizeof(_stream_block));
+}
+
+AESCTRDecryptor::~AESCTRDecryptor() {
+    mbedtls_aes_free(&_ctx);
+    mbedtls_md_free(&_mac);
+}
+
+size_t AESCTRDecryptor::decrypt(uint8_t* buffer, size_t size, size_t* len) {
+    size_t consumed = 0;
+    size_t cipher_len = 0;
+
+    if(_iv_copied < IV_SIZE) {
+        consumed = IV_SIZE - _iv_copied < size ? IV_SIZE - _iv_copied : size;
+        memcpy(_nonce_counter + _iv_copied, buffer, consumed);
+        mbedtls_md_hmac_update(&_mac, buffer, consumed);
+        _iv_copied += consumed;
+        _position += consumed;
+    }
+
+    if(_position < _tag_offset) {
+        cipher_len = _tag_offset - _position < size - consumed ? _tag_offset - _position : size - consumed;
+    }
+
+    if(cipher_len > 0) {
+        // the ciphertext is authenticated before it is decrypted in place
+        mbedtls_md_hmac_update(&_mac, buffer + consumed, cipher_len);
+        mbedtls_aes_crypt_ctr(&_ctx, cipher_len, &_nc_off, _nonce_counter, _stream_block,
+            buffer + consumed, buffer + consumed);
+        _position += cipher_len;
+    }
+
+    // the bytes following the ciphertext are the tag, any excess is left to the length checks
+    for(size_t i = consumed + cipher_len; i < size && _tag_copied < TAG_SIZE; i++) {
+        _tag[_tag_copied++] = buffer[i];
+    }
+
+    *len = cipher_len;
+    return consumed;
+}
+
+bool AESCTRDecryptor::authentic() {
+    uint8_t tag[TAG_SIZE];
+    uint8_t diff = 0;
+
+    if(!_valid || _tag_copied < TAG_SIZE || mbedtls_md_hmac_finish(&_mac, tag) != 0) {
+        return false;
+    }
+
+    // constant time comparison
+    for(size_t i = 0; i < TAG_SIZE; i++) {
+        diff |= tag[i] ^ _tag[i];
+    }
+
+    return diff == 0;
+}
@@ -0,0 +1,97 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+
+/**************************************************************************************
+   AES-CTR DECRYPTOR CLASS
+ **************************************************************************************/
+
+/**
+ * Decrypt an AES-CTR payload and authenticate it with HMAC-SHA256 (encrypt-then-MAC).
+ * The payload is the IV_SIZE bytes initial counter block, the ciphertext and the
+ * TAG_SIZE bytes tag:
+ *
+ *   tag = HMAC-SHA256(mac key, associated data | initial counter block | ciphertext)
+ *   mac key = HMAC-SHA256(key, MAC_KEY_LABEL)
+ *
+ * The plaintext is passed on as it is decrypted, the tag can only be checked with
+ * authentic() once the whole payload has been received.
+ */
+class AESCTRDecryptor {
+public:
+
+    static const size_t IV_SIZE = 16;
+    static const size_t TAG_SIZE = 32;
+    static constexpr const char* MAC_KEY_LABEL = "Arduino_ESP32_OTA MAC";
+
+    /**
+     * @param key: AES key, it must stay valid for the whole download
+     * @param key_len: key length in bytes, 16, 24 or 32
+     * @param ad: associated data, authenticated but not encrypted
+     * @param ad_len: length of the associated data
+     * @param payload_len: length of the payload, including the initial counter block and the tag
+     */
+    AESCTRDecryptor(const uint8_t* key, size_t key_len, const uint8_t* ad, size_t ad_len, size_t payload_len);
+    ~AESCTRDecryptor();
+
+    /**
+     * @return true if the key has been accepted by the AES engine and the payload
+     *         is long enough for the initial counter block and the tag
+     */
+    bool valid() const { return _valid; }
+
+    /**
+     * decrypt in place the provided buffer, the leading bytes that belong to the
+     * initial counter block and the trailing bytes that belong to the tag are consumed
+     * and not decrypted
+     * @param len: set to the number of decrypted bytes
+     * @return the number of leading bytes consumed as counter block, the decrypted
+     *         data starts at buffer + returned value
+     */
+    size_t decrypt(uint8_t* buffer, size_t size, size_t* len);
+
+    /**
+     * @return true if the whole payload has been received and the tag matches
+     */
+    bool authentic();
+
+private:
+    mbedtls_aes_context _ctx;
+    mbedtls_md_context_t _mac;
+    bool _valid;
+
+    uint8_t _nonce_counter[IV_SIZE];
+    uint8_t _stream_block[IV_SIZE];
+    size_t _nc_off;
+    size_t _iv_copied;
+
+    // payload bytes received, the tag starts at _tag_offset
+    size_t _position;
+    size_t _tag_offset;
+    uint8_t _tag[TAG_SIZE];
+    size_t _tag_copied;
+};
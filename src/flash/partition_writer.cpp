@@ -0,0 +1,255 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "partition_writer.h"
+
+#include <string.h>
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+
+// esp_ptr_dma_capable() moved to esp_memory_utils.h in ESP-IDF 5, the
+// buffer is only checked for alignment where neither header is available
+#if __has_include(<esp_memory_utils.h>)
+  #include <esp_memory_utils.h>
+  #define OTA_PARTITION_WRITER_DMA_CHECK
+#elif __has_include(<soc/soc_memory_layout.h>)
+  #include <soc/soc_memory_layout.h>
+  #define OTA_PARTITION_WRITER_DMA_CHECK
+#endif
+
+/**************************************************************************************
+   OTA PARTITION WRITER CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+OtaPartitionWriter::OtaPartitionWriter()
+: _partition(nullptr), _base(0), _buffer(nullptr), _own_buffer(false)
+, _buffered(0), _capacity(0), _offset(0), _programmed(false), _error(false), _skipped_sectors(0), _header_len(0)
+, _closed(nullptr), _closed_base(0), _closed_header_len(0) {
+}
+
+OtaPartitionWriter::~OtaPartitionWriter() {
+    release();
+}
+
+bool OtaPartitionWriter::begin(const esp_partition_t* partition, uint8_t* buffer, size_t offset) {
+    release();
+
+    if(partition == nullptr || partition->encrypted ||
+       offset % SECTOR_SIZE != 0 || offset >= partition->size) {
+        return false;
+    }
+
+    // esp_partition_write reads the buffer by words, or by DMA
+    if(buffer != nullptr && ((uintptr_t)buffer & 3) != 0) {
+        return false;
+    }
+#if defined(OTA_PARTITION_WRITER_DMA_CHECK)
+    if(buffer != nullptr && !esp_ptr_dma_capable(buffer)) {
+        return false;
+    }
+#endif
+
+    if(buffer == nullptr) {
+        buffer = (uint8_t*)heap_caps_malloc(SECTOR_SIZE, MALLOC_CAP_DMA);
+        if(buffer == nullptr) {
+            return false;
+        }
+        _own_buffer = true;
+    }
+
+    _partition = partition;
+    _base = offset;
+    _buffer = buffer;
+    _buffered = 0;
+    _capacity = partition->size - offset < SECTOR_SIZE ? partition->size - offset : SECTOR_SIZE;
+    _offset = 0;
+    _programmed = false;
+    _error = false;
+    _header_len = 0;
+
+    if(_closed == nullptr) {
+        _skipped_sectors = 0;
+    }
+
+    return true;
+}
+
+bool OtaPartitionWriter::write(const uint8_t* data, size_t len) {
+    while(len > 0) {
+        if(_buffered >= _capacity) {
+            return overrun();
+        }
+
+        size_t chunk = _capacity - _buffered < len ? _capacity - _buffered : len;
+
+        memcpy(_buffer + _buffered, data, chunk);
+        _buffered += chunk;
+        _programmed = true;
+        data += chunk;
+        len -= chunk;
+
+        if(_buffered == _capacity && !flush()) {
+            return false;
+        }
+    }
+
+    return !_error;
+}
+
+bool OtaPartitionWriter::skip(size_t len) {
+    while(len > 0) {
+        if(_buffered >= _capacity) {
+            return overrun();
+        }
+
+        size_t chunk = _capacity - _buffered < len ? _capacity - _buffered : len;
+
+        // the bytes are kept in the buffer, the sector may still need to be erased
+        memset(_buffer + _buffered, 0xFF, chunk);
+        _buffered += chunk;
+        len -= chunk;
+
+        if(_buffered == _capacity && !flush()) {
+            return false;
+        }
+    }
+
+    return !_error;
+}
+
+bool OtaPartitionWriter::close() {
+    if(_partition == nullptr || _closed != nullptr) {
+        return false;
+    }
+
+    bool res = flush() && _header_len > 0;
+
+    if(res) {
+        _closed = _partition;
+        _closed_base = _base;
+        memcpy(_closed_header, _header, _header_len);
+        _closed_header_len = _header_len;
+    }
+
+    release();
+
+    return res;
+}
+
+bool OtaPartitionWriter::end() {
+    if(_partition == nullptr) {
+        return false;
+    }
+
+    bool res = flush() && _header_len > 0;
+
+    // the partition content becomes valid only when its first bytes are programmed
+    if(res && _closed != nullptr) {
+        res = esp_partition_write(_closed, _closed_base, _closed_header, _closed_header_len) == ESP_OK;
+    }
+
+    if(res) {
+        res = esp_partition_write(_partition, _base, _header, _header_len) == ESP_OK;
+    }
+
+    if(res && _partition->type == ESP_PARTITION_TYPE_APP) {
+        res = esp_ota_set_boot_partition(_partition) == ESP_OK;
+    }
+
+    _closed = nullptr;
+    release();
+
+    return res;
+}
+
+void OtaPartitionWriter::abort() {
+    _closed = nullptr;
+    release();
+}
+
+bool OtaPartitionWriter::flush() {
+    if(_error || _buffered == 0) {
+        return !_error;
+    }
+
+    if(_offset == 0) {
+        _header_len = _buffered < HEADER_SIZE ? _buffered : HEADER_SIZE;
+        memcpy(_header, _buffer, _header_len);
+        memset(_buffer, 0xFF, _header_len);
+    }
+
+    // the first sector is always rewritten, its header has to be erased until end()
+    if(_offset != 0 && unchanged()) {
+        _skipped_sectors++;
+    } else {
+        _error = esp_partition_erase_range(_partition, _base + _offset, SECTOR_SIZE) != ESP_OK;
+
+        // a sector made only of skipped bytes is left erased
+        if(!_error && _programmed) {
+            _error = esp_partition_write(_partition, _base + _offset, _buffer, _buffered) != ESP_OK;
+        }
+    }
+
+    _offset += _buffered;
+    _buffered = 0;
+    _programmed = false;
+
+    if(_error) {
+        _capacity = 0;
+    } else if(_partition->size - _base - _offset < SECTOR_SIZE) {
+        _capacity = _partition->size - _base - _offset;
+    }
+
+    return !_error;
+}
+
+bool OtaPartitionWriter::overrun() {
+    // the image does not fit in the partition, or a previous write failed
+    _error = true;
+    _capacity = 0;
+    return false;
+}
+
+bool OtaPartitionWriter::unchanged() {
+    // reading and comparing a sector is much faster than erasing it, and it saves flash wear
+    uint32_t chunk[64];
+
+    for(size_t offset = 0; offset < _buffered; offset += sizeof(chunk)) {
+        size_t len = _buffered - offset < sizeof(chunk) ? _buffered - offset : sizeof(chunk);
+
+        if(esp_partition_read(_partition, _base + _offset + offset, chunk, len) != ESP_OK ||
+           memcmp(chunk, _buffer + offset, len) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void OtaPartitionWriter::release() {
+    if(_own_buffer) {
+        heap_caps_free(_buffer);
+    }
+
+    _partition = nullptr;
+    _buffer = nullptr;
+    _own_buffer = false;
+}
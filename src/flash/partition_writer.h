@@ -0,0 +1,139 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_partition.h>
+
+/**************************************************************************************
+   OTA PARTITION WRITER CLASS
+ **************************************************************************************/
+
+/**
+ * Write an image straight to a flash partition with esp_partition_erase_range and
+ * esp_partition_write, one sector at a time, without going through the Update library.
+ * The first bytes of the image are programmed last, so that a partially written
+ * app partition is never bootable. Sectors whose content already matches the data
+ * to be written are neither erased nor programmed, sectors that only contain erased
+ * bytes are erased and not programmed.
+ */
+class OtaPartitionWriter {
+public:
+
+    static const size_t SECTOR_SIZE = 4096;
+    static const size_t HEADER_SIZE = 16;
+
+    OtaPartitionWriter();
+    ~OtaPartitionWriter();
+
+    /**
+     * start writing a partition
+     * @param partition: destination partition, encrypted partitions are not supported
+     * @param buffer: SECTOR_SIZE bytes, word aligned and DMA capable buffer, if nullptr
+     *                it is allocated from the DMA capable heap. Any other buffer is
+     *                rejected
+     * @param offset: sector aligned offset of the image in the partition, e.g. FFat
+     *                images start after the first sector of the FAT partition
+     * @return true on success
+     */
+    bool begin(const esp_partition_t* partition, uint8_t* buffer = nullptr, size_t offset = 0);
+
+    /**
+     * once a write has failed, e.g. past the end of the partition, the following
+     * bytes are dropped and false is returned until begin() or abort()
+     */
+    inline bool write(uint8_t data) {
+        if(_buffered >= _capacity) {
+            return overrun();
+        }
+
+        _buffer[_buffered++] = data;
+        _programmed = true;
+        return _buffered < _capacity || flush();
+    }
+
+    bool write(const uint8_t* data, size_t len);
+
+    /**
+     * advance the write position by len erased (0xFF) bytes
+     */
+    bool skip(size_t len);
+
+    /**
+     * program the pending data and hold the image header back, begin() can then
+     * write another partition. The closed partition becomes valid when end() is
+     * called for the next one, e.g. after the image holding both has been verified,
+     * abort() leaves it without its first bytes
+     * @return true if the whole image has been written
+     */
+    bool close();
+
+    /**
+     * program the pending data and the image header, after the header of a closed
+     * partition if any, app partitions are then selected as boot partition
+     * @return true if the whole image has been written and, for app partitions, validated
+     */
+    bool end();
+
+    void abort();
+
+    inline bool isRunning() const { return _partition != nullptr; }
+
+    // true if a sector could not be written since begin
+    inline bool hasError() const { return _error; }
+
+    // number of bytes written since begin
+    inline size_t size() const { return _offset + _buffered; }
+
+    // number of sectors left untouched since begin because they already had the right
+    // content, a closed partition included
+    inline uint32_t skippedSectors() const { return _skipped_sectors; }
+
+private:
+    const esp_partition_t* _partition;
+    size_t _base;
+    uint8_t* _buffer;
+    bool _own_buffer;
+    size_t _buffered;
+    // bytes the buffer can take before it is flushed: a sector, the space left in
+    // the partition, or 0 once a write has failed
+    size_t _capacity;
+    size_t _offset;
+    bool _programmed;
+    bool _error;
+    uint32_t _skipped_sectors;
+
+    uint8_t _header[HEADER_SIZE];
+    size_t _header_len;
+
+    // partition closed by close(), its header is programmed by end()
+    const esp_partition_t* _closed;
+    size_t _closed_base;
+    uint8_t _closed_header[HEADER_SIZE];
+    size_t _closed_header_len;
+
+    bool flush();
+    bool overrun();
+    bool unchanged();
+    void release();
+};
@@ -0,0 +1,346 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "http_client.h"
+
+#include <ctype.h>
+#include <string.h>
+
+/**************************************************************************************
+   OTA HTTP CLIENT CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+OtaHttpClient::OtaHttpClient(uint8_t* buffer, size_t size)
+: _buffer(buffer), _size(size), _location(nullptr), _location_size(0), _accept_encoding("identity") {
+    reset();
+}
+
+void OtaHttpClient::setLocationBuffer(char* location, size_t size) {
+    _location = location;
+    _location_size = size;
+
+    if(_location != nullptr && _location_size > 0) {
+        _location[0] = '\0';
+    }
+}
+
+void OtaHttpClient::setAcceptEncoding(const char* encoding) {
+    _accept_encoding = encoding;
+}
+
+int OtaHttpClient::get(Client& client, const char* host, uint16_t port, const char* path, const char* query, uint32_t timeout_ms) {
+    reset();
+
+    if(!client.connected() && !client.connect(host, port)) {
+        return ConnectionFailed;
+    }
+
+    sendRequest(client, host, port, path, query);
+
+    unsigned long const start = millis();
+
+    while(_state != FSM_DONE && _state != FSM_ERROR) {
+        int available = client.available();
+
+        if(available <= 0) {
+            if(!client.connected()) {
+                return InvalidResponse;
+            }
+            if(millis() - start > timeout_ms) {
+                return TimedOut;
+            }
+            delay(1);
+            continue;
+        }
+
+        // read a whole block and parse it in place, the bytes following the
+        // headers are the beginning of the body and are kept in the buffer
+        int len = client.read(_buffer, (size_t)available < _size ? available : _size);
+
+        for(int i = 0; i < len && _state != FSM_ERROR; i++) {
+            parse(_buffer[i]);
+
+            if(_state == FSM_DONE) {
+                _body_available = len - i - 1;
+                memmove(_buffer, _buffer + i + 1, _body_available);
+                break;
+            }
+        }
+    }
+
+    return _state == FSM_DONE ? Success : InvalidResponse;
+}
+
+bool OtaHttpClient::skipBody(Client& client, uint32_t timeout_ms) {
+    if(!_keep_alive || _chunked || _content_length == NO_CONTENT_LENGTH || _content_length > MAX_SKIPPED_BODY) {
+        return false;
+    }
+
+    size_t remaining = (size_t)_content_length > _body_available ? _content_length - _body_available : 0;
+    unsigned long const start = millis();
+
+    _body_available = 0;
+
+    while(remaining > 0) {
+        int available = client.available();
+
+        if(available <= 0) {
+            if(!client.connected() || millis() - start > timeout_ms) {
+                return false;
+            }
+            delay(1);
+            continue;
+        }
+
+        size_t len = (size_t)available < _size ? available : _size;
+        if(len > remaining) {
+            len = remaining;
+        }
+
+        int read = client.read(_buffer, len);
+        if(read > 0) {
+            remaining -= read;
+        }
+    }
+
+    return true;
+}
+
+void OtaHttpClient::reset() {
+    _status_code = 0;
+    _content_length = NO_CONTENT_LENGTH;
+    _chunked = false;
+    _gzip = false;
+    _keep_alive = true;
+    _location_truncated = false;
+    _etag[0] = '\0';
+    _body_available = 0;
+    _state = FSM_STATUS_VERSION;
+    _header = HEADER_OTHER;
+    _name_len = 0;
+    _value_len = 0;
+    _line_empty = true;
+
+    if(_location != nullptr && _location_size > 0) {
+        _location[0] = '\0';
+    }
+}
+
+void OtaHttpClient::sendRequest(Client& client, const char* host, uint16_t port, const char* path, const char* query) {
+    // the request is assembled in the scratch buffer, so that it is sent with
+    // as few writes (and TLS records) as possible
+    size_t len = 0;
+    auto append = [&](const char* str) {
+        while(*str != '\0') {
+            if(len == _size) {
+                client.write(_buffer, len);
+                len = 0;
+            }
+            _buffer[len++] = *str++;
+        }
+    };
+
+    append("GET ");
+    append(path);
+    if(query != nullptr && query[0] != '\0') {
+        append("?");
+        append(query);
+    }
+    append(" HTTP/1.1\r\nHost: ");
+    append(host);
+    if(port != 80 && port != 443) {
+        char port_str[7];
+        snprintf(port_str, sizeof(port_str), ":%u", port);
+        append(port_str);
+    }
+    append("\r\nUser-Agent: Arduino_ESP32_OTA\r\nAccept-Encoding: ");
+    append(_accept_encoding);
+    append("\r\n\r\n");
+
+    client.write(_buffer, len);
+}
+
+void OtaHttpClient::parse(uint8_t c) {
+    switch(_state) {
+    case FSM_STATUS_VERSION:
+        if(c == ' ') {
+            _state = FSM_STATUS_CODE;
+        } else if(c == '\n') {
+            _state = FSM_ERROR;
+        }
+        break;
+    case FSM_STATUS_CODE:
+        if(isdigit(c) && _status_code < 100) {
+            _status_code = _status_code * 10 + (c - '0');
+        } else if(c == ' ' || c == '\r' || c == '\n') {
+            _state = _status_code >= 100 ? FSM_STATUS_REASON : FSM_ERROR;
+
+            if(c == '\n' && _state == FSM_STATUS_REASON) {
+                _state = FSM_HEADER_NAME;
+            }
+        } else {
+            _state = FSM_ERROR;
+        }
+        break;
+    case FSM_STATUS_REASON:
+        if(c == '\n') {
+            _state = FSM_HEADER_NAME;
+        }
+        break;
+    case FSM_HEADER_NAME:
+        if(c == '\r') {
+            break;
+        } else if(c == '\n') {
+            // an empty line terminates the headers, a line without ':' is skipped
+            _state = _line_empty ? FSM_DONE : FSM_HEADER_NAME;
+            _name_len = 0;
+            _line_empty = true;
+        } else if(c == ':') {
+            headerName();
+            _value_len = 0;
+            _line_empty = false;
+            _state = FSM_HEADER_VALUE_START;
+        } else {
+            if(_name_len < sizeof(_name)) {
+                _name[_name_len] = tolower(c);
+            }
+            if(_name_len < UINT8_MAX) {
+                _name_len++;
+            }
+            _line_empty = false;
+        }
+        break;
+    case FSM_HEADER_VALUE_START:
+        if(c == ' ' || c == '\t') {
+            break;
+        }
+        _state = FSM_HEADER_VALUE;
+        /* fall through */
+    case FSM_HEADER_VALUE:
+        if(c == '\r') {
+            break;
+        } else if(c == '\n') {
+            _state = FSM_HEADER_NAME;
+            _name_len = 0;
+            _line_empty = true;
+        } else {
+            headerValue(c);
+        }
+        break;
+    case FSM_DONE:
+    case FSM_ERROR:
+        break;
+    }
+}
+
+void OtaHttpClient::headerName() {
+    auto is = [this](const char* name) {
+        return strlen(name) == _name_len && memcmp(_name, name, _name_len) == 0;
+    };
+
+    if(is("content-length")) {
+        _header = HEADER_CONTENT_LENGTH;
+    } else if(is("transfer-encoding")) {
+        _header = HEADER_TRANSFER_ENCODING;
+    } else if(is("content-encoding")) {
+        _header = HEADER_CONTENT_ENCODING;
+    } else if(is("etag")) {
+        _header = HEADER_ETAG;
+    } else if(is("location")) {
+        _header = HEADER_LOCATION;
+    } else if(is("connection")) {
+        _header = HEADER_CONNECTION;
+    } else {
+        _header = HEADER_OTHER;
+    }
+}
+
+void OtaHttpClient::headerValue(char c) {
+    static const char chunked[] = "chunked";
+    static const char close[] = "close";
+    static const char gzip[] = "gzip";
+
+    switch(_header) {
+    case HEADER_CONTENT_LENGTH:
+        if(isdigit(c) && (_value_len == 0 || _content_length <= (INT32_MAX - 9) / 10)) {
+            _content_length = (_value_len == 0 ? 0 : _content_length * 10) + (c - '0');
+            _value_len++;
+        } else if(c != ' ' && c != '\t') {
+            _state = FSM_ERROR;
+        }
+        break;
+    case HEADER_TRANSFER_ENCODING:
+        // look for "chunked" in the list of codings, _value_len is the matched length
+        if(tolower(c) == chunked[_value_len]) {
+            _value_len++;
+        } else {
+            _value_len = tolower(c) == chunked[0] ? 1 : 0;
+        }
+        if(_value_len == sizeof(chunked) - 1) {
+            _chunked = true;
+            _value_len = 0;
+        }
+        break;
+    case HEADER_CONTENT_ENCODING:
+        // "gzip" or "x-gzip", _value_len is the matched length
+        if(tolower(c) == gzip[_value_len]) {
+            _value_len++;
+        } else {
+            _value_len = tolower(c) == gzip[0] ? 1 : 0;
+        }
+        if(_value_len == sizeof(gzip) - 1) {
+            _gzip = true;
+            _value_len = 0;
+        }
+        break;
+    case HEADER_ETAG:
+        if(_value_len < ETAG_SIZE - 1) {
+            _etag[_value_len++] = c;
+            _etag[_value_len] = '\0';
+        }
+        break;
+    case HEADER_LOCATION:
+        if(_location != nullptr && _value_len + 1 < _location_size) {
+            _location[_value_len++] = c;
+            _location[_value_len] = '\0';
+        } else {
+            _location_truncated = true;
+        }
+        break;
+    case HEADER_CONNECTION:
+        // only "close" is relevant, _value_len is the matched length of the current
+        // token in the list, past sizeof(close) once a whole token was "close"
+        if(_value_len > sizeof(close) || c == ' ' || c == '\t') {
+            break;
+        } else if(c == ',') {
+            _value_len = _keep_alive ? 0 : sizeof(close) + 1;
+        } else if(_value_len < sizeof(close) - 1 && tolower(c) == close[_value_len]) {
+            _value_len++;
+            _keep_alive = _value_len != sizeof(close) - 1;
+        } else {
+            _value_len = sizeof(close);
+            _keep_alive = true;
+        }
+        break;
+    case HEADER_OTHER:
+        break;
+    }
+}
@@ -0,0 +1,148 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <Arduino.h>
+#include <Client.h>
+#include <stdint.h>
+
+/**************************************************************************************
+   OTA HTTP CLIENT CLASS
+ **************************************************************************************/
+
+/**
+ * Minimal HTTP/1.1 client: it sends a GET request and parses the response status
+ * line and the headers needed by the OTA process, without allocating memory.
+ * The response is read in blocks into the buffer provided by the caller; once the
+ * headers are parsed the body bytes already received are moved at the beginning
+ * of the same buffer and the rest of the body can be read straight from the Client.
+ */
+class OtaHttpClient {
+public:
+
+    enum Result: int {
+        Success          =  0,
+        ConnectionFailed = -1,
+        TimedOut         = -2,
+        InvalidResponse  = -3
+    };
+
+    static const int32_t NO_CONTENT_LENGTH = -1;
+    static const size_t ETAG_SIZE = 64;
+    static const int32_t MAX_SKIPPED_BODY = 1024;
+
+    /**
+     * @param buffer: scratch buffer used to receive the response headers, the first
+     *                body bytes are left in it
+     * @param size: size of the buffer
+     */
+    OtaHttpClient(uint8_t* buffer, size_t size);
+
+    /**
+     * provide a buffer where the value of the Location header is stored,
+     * longer values are truncated
+     */
+    void setLocationBuffer(char* location, size_t size);
+
+    /**
+     * value of the Accept-Encoding header of the request, "identity" by default;
+     * the string is not copied
+     */
+    void setAcceptEncoding(const char* encoding);
+
+    /**
+     * send a GET request for path?query and parse the response headers, the client
+     * is connected to the server only if it is not already connected
+     * @return Success or a negative Result value
+     */
+    int get(Client& client, const char* host, uint16_t port, const char* path, const char* query, uint32_t timeout_ms);
+
+    /**
+     * read and discard the body of the response, so that the connection can be
+     * used for another request
+     * @return true if the connection can be reused, false if it has to be closed
+     */
+    bool skipBody(Client& client, uint32_t timeout_ms);
+
+    inline int statusCode() const        { return _status_code; }
+    inline int32_t contentLength() const { return _content_length; }
+    inline bool chunked() const          { return _chunked; }
+    inline bool gzip() const             { return _gzip; }
+    inline const char* etag() const      { return _etag; }
+    inline bool keepAlive() const        { return _keep_alive; }
+
+    // the Location header did not fit into the buffer provided with setLocationBuffer
+    inline bool locationTruncated() const { return _location_truncated; }
+
+    // number of body bytes already received at the beginning of the buffer
+    inline size_t bodyAvailable() const  { return _body_available; }
+
+private:
+    uint8_t* _buffer;
+    size_t _size;
+
+    char* _location;
+    size_t _location_size;
+    const char* _accept_encoding;
+
+    int _status_code;
+    int32_t _content_length;
+    bool _chunked;
+    bool _gzip;
+    bool _keep_alive;
+    bool _location_truncated;
+    char _etag[ETAG_SIZE];
+    size_t _body_available;
+
+    enum FSM_STATES: uint8_t {
+        FSM_STATUS_VERSION,
+        FSM_STATUS_CODE,
+        FSM_STATUS_REASON,
+        FSM_HEADER_NAME,
+        FSM_HEADER_VALUE_START,
+        FSM_HEADER_VALUE,
+        FSM_DONE,
+        FSM_ERROR
+    } _state;
+
+    enum HEADERS: uint8_t {
+        HEADER_OTHER,
+        HEADER_CONTENT_LENGTH,
+        HEADER_TRANSFER_ENCODING,
+        HEADER_CONTENT_ENCODING,
+        HEADER_ETAG,
+        HEADER_LOCATION,
+        HEADER_CONNECTION
+    } _header;
+
+    // the longest header we are interested in is "transfer-encoding"
+    char _name[18];
+    uint8_t _name_len;
+    size_t _value_len;
+    bool _line_empty;
+
+    void reset();
+    void sendRequest(Client& client, const char* host, uint16_t port, const char* path, const char* query);
+    void parse(uint8_t c);
+    void headerName();
+    void headerValue(char c);
+};
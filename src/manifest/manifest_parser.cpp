@@ -0,0 +1,162 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "manifest_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************
+   OTA MANIFEST PARSER CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+OtaManifestParser::OtaManifestParser(uint32_t magic, uint32_t running_version, uint8_t codecs)
+: _magic(magic), _running_version(running_version), _codecs(codecs)
+, _line_len(0), _overflow(false), _found(false), _image(), _invalid_lines(0) {
+    _url[0] = '\0';
+}
+
+void OtaManifestParser::parse(const uint8_t* buffer, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        char c = buffer[i];
+
+        if(c == '\n') {
+            end();
+        } else if(c == '\r') {
+            continue;
+        } else if(_line_len < LINE_SIZE - 1) {
+            _line[_line_len++] = c;
+        } else {
+            // the line is dropped, an url may have been truncated
+            _overflow = true;
+        }
+    }
+}
+
+void OtaManifestParser::end() {
+    if(_overflow) {
+        _invalid_lines++;
+    } else if(_line_len > 0) {
+        _line[_line_len] = '\0';
+        parseLine();
+    }
+
+    _line_len = 0;
+    _overflow = false;
+}
+
+void OtaManifestParser::parseLine() {
+    char* fields[7];
+    size_t count = 0;
+    char* save = nullptr;
+
+    if(_line[0] == '#') {
+        return;
+    }
+
+    for(char* field = strtok_r(_line, " \t", &save); field != nullptr; field = strtok_r(nullptr, " \t", &save)) {
+        if(count == sizeof(fields) / sizeof(fields[0])) {
+            _invalid_lines++;
+            return;
+        }
+        fields[count++] = field;
+    }
+
+    if(count == 0) {
+        return;
+    }
+
+    Image image;
+    uint32_t base = 0;
+    char* end;
+
+    uint32_t magic = strtoul(fields[0], &end, 16);
+    bool valid = count == sizeof(fields) / sizeof(fields[0]) && *end == '\0' &&
+        parseVersion(fields[1], &image.version) &&
+        (strcmp(fields[2], "-") == 0 || parseVersion(fields[2], &base));
+
+    if(valid) {
+        image.delta = base != 0;
+
+        if(strcmp(fields[3], "none") == 0) {
+            image.codec = CodecNone;
+        } else if(strcmp(fields[3], "lzss") == 0) {
+            image.codec = CodecLZSS;
+        } else if(strcmp(fields[3], "deflate") == 0) {
+            image.codec = CodecDeflate;
+        } else {
+            // a codec introduced after this parser, the image is simply not supported
+            return;
+        }
+
+        image.size = strtoul(fields[4], &end, 10);
+        valid = *end == '\0';
+        image.crc32 = strtoul(fields[5], &end, 16);
+        valid = valid && *end == '\0' && strlen(fields[6]) > 0;
+    }
+
+    if(!valid) {
+        _invalid_lines++;
+        return;
+    }
+
+    // early rejection: images for other boards, codecs that are not built in,
+    // images older than the running one and deltas built against another version
+    if(magic != _magic || !(_codecs & (1 << image.codec)) ||
+       (_running_version != 0 && image.version <= _running_version) ||
+       (image.delta && base != _running_version) ||
+       !better(image)) {
+        return;
+    }
+
+    _found = true;
+    _image = image;
+    strcpy(_url, fields[6]);
+}
+
+bool OtaManifestParser::better(const Image& image) const {
+    if(!_found || image.version != _image.version) {
+        return !_found || image.version > _image.version;
+    }
+
+    if(image.delta != _image.delta) {
+        return image.delta;
+    }
+
+    return image.size < _image.size;
+}
+
+bool OtaManifestParser::parseVersion(const char* str, uint32_t* version) {
+    uint32_t parts[3];
+    char* end;
+
+    for(size_t i = 0; i < 3; i++) {
+        parts[i] = strtoul(str, &end, 10);
+
+        if(end == str || parts[i] > UINT8_MAX || *end != (i < 2 ? '.' : '\0')) {
+            return false;
+        }
+        str = end + 1;
+    }
+
+    *version = OtaManifestParser::version(parts[0], parts[1], parts[2]);
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**************************************************************************************
+   OTA MANIFEST PARSER CLASS
+ **************************************************************************************/
+
+/**
+ * Select an image from a manifest while it is received, without allocating memory.
+ * The manifest is a text file with one image per line, empty lines and lines starting
+ * with '#' are ignored, fields are separated by spaces:
+ *
+ *   <magic> <version> <base> <codec> <size> <crc32> <url>
+ *
+ * magic:   magic number of the board the image is built for, in hex
+ * version: version of the image, major.minor.patch
+ * base:    '-' for a full image, otherwise the version the image has been built
+ *          against, e.g. an LZSS image with a primed window
+ * codec:   none, lzss or deflate; a none payload is written as it is, without a
+ *          primed window
+ * size:    size of the .ota file in bytes
+ * crc32:   crc32 field of the ota header, in hex
+ * url:     absolute url of the .ota file
+ *
+ * Among the images for the board, using a supported codec and applicable to the
+ * running version, the highest version is selected; for the same version images
+ * built against the running version are preferred, then the smallest one.
+ */
+class OtaManifestParser {
+public:
+
+    static const size_t LINE_SIZE = 256;
+
+    enum Codec: uint8_t {
+        CodecNone    = 0,
+        CodecLZSS    = 1,
+        CodecDeflate = 2
+    };
+
+    struct Image {
+        uint32_t version;
+        bool delta;
+        Codec codec;
+        uint32_t size;
+        uint32_t crc32;
+    };
+
+    /**
+     * @param magic: magic number of the board
+     * @param running_version: version of the running firmware as returned by version(),
+     *                         0 if it is unknown: any version is accepted but delta images are not
+     * @param codecs: bitmask of the supported codecs, bit n set for Codec n
+     */
+    OtaManifestParser(uint32_t magic, uint32_t running_version, uint8_t codecs);
+
+    void parse(const uint8_t* buffer, size_t size);
+
+    // parse the last line when it is not terminated by a new line
+    void end();
+
+    inline bool found() const           { return _found; }
+    inline const Image& image() const   { return _image; }
+    inline const char* url() const      { return _url; }
+
+    // number of lines that could not be parsed
+    inline uint32_t invalidLines() const { return _invalid_lines; }
+
+    static inline uint32_t version(uint8_t major, uint8_t minor, uint8_t patch) {
+        return ((uint32_t)major << 16) | ((uint32_t)minor << 8) | patch;
+    }
+
+private:
+    uint32_t _magic;
+    uint32_t _running_version;
+    uint8_t _codecs;
+
+    char _line[LINE_SIZE];
+    size_t _line_len;
+    bool _overflow;
+
+    bool _found;
+    Image _image;
+    char _url[LINE_SIZE];
+    uint32_t _invalid_lines;
+
+    void parseLine();
+    bool better(const Image& image) const;
+    static bool parseVersion(const char* str, uint32_t* version);
+};
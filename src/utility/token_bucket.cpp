@@ -0,0 +1,73 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include "token_bucket.h"
+
+/**************************************************************************************
+   TOKEN BUCKET CLASS IMPLEMENTATION
+ **************************************************************************************/
+
+TokenBucket::TokenBucket()
+: _rate(0), _burst(0), _tokens(0), _last_us(0) {
+}
+
+void TokenBucket::configure(uint32_t rate, uint32_t burst) {
+    _rate = rate;
+    _burst = burst != 0 ? burst : rate;
+
+    if(_tokens > _burst) {
+        _tokens = _burst;
+    }
+}
+
+void TokenBucket::reset(uint32_t now_us) {
+    _tokens = _burst;
+    _last_us = now_us;
+}
+
+size_t TokenBucket::available(uint32_t now_us) {
+    if(_rate == 0) {
+        return UNLIMITED;
+    }
+
+    uint32_t elapsed = now_us - _last_us;
+    uint64_t added = (uint64_t)elapsed * _rate / 1000000;
+
+    if(_tokens + added >= _burst) {
+        _tokens = _burst;
+        _last_us = now_us;
+    } else if(added > 0) {
+        // only account for the time that produced whole tokens, the remainder
+        // is kept for the next call so low rates are not rounded down to zero
+        _tokens += added;
+        _last_us += (uint32_t)(added * 1000000 / _rate);
+    }
+
+    return _tokens;
+}
+
+void TokenBucket::consume(size_t tokens) {
+    if(_rate == 0) {
+        return;
+    }
+
+    _tokens = tokens < _tokens ? _tokens - tokens : 0;
+}
@@ -0,0 +1,63 @@
+/*
+   This file is part of Arduino_ESP32_OTA.
+
+   Copyright 2026 ARDUINO SA (http://www.arduino.cc/)
+
+   This software is released under the GNU General Public License version 3,
+   which covers the main part of arduino-cli.
+   The terms of this license can be found at:
+   https://www.gnu.org/licenses/gpl-3.0.en.html
+
+   You can be released from the requirements of the above licenses by purchasing
+   a commercial license. Buying such a license is mandatory if you want to modify or
+   otherwise use the software for commercial activities involving the Arduino
+   software without disclosing the source code of your own applications. To purchase
+   a commercial license, send an email to license@arduino.cc.
+*/
+
+#pragma once
+
+/**************************************************************************************
+   INCLUDE
+ **************************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**************************************************************************************
+   TOKEN BUCKET CLASS
+ **************************************************************************************/
+
+class TokenBucket {
+public:
+
+    static const size_t UNLIMITED = SIZE_MAX;
+
+    TokenBucket();
+
+    /**
+     * configure the bucket, it can be called while the bucket is in use
+     * @param rate: tokens (bytes) added every second, 0 disables the limit
+     * @param burst: maximum number of tokens that can be accumulated,
+     *               0 selects one second worth of tokens
+     */
+    void configure(uint32_t rate, uint32_t burst);
+
+    /**
+     * fill the bucket to its burst size and restart counting time from now_us
+     */
+    void reset(uint32_t now_us);
+
+    /**
+     * @return the number of tokens available at now_us, UNLIMITED if no rate is configured
+     */
+    size_t available(uint32_t now_us);
+
+    void consume(size_t tokens);
+
+private:
+    uint32_t _rate;
+    uint32_t _burst;
+    uint32_t _tokens;
+    uint32_t _last_us;
+};